@@ -0,0 +1,164 @@
+#include "batch_analysis.h"
+#include "search.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr int DEFAULT_DEPTH = 10;
+constexpr int UNLIMITED_DEPTH = 64;
+constexpr size_t IN_FLIGHT_PER_WORKER = 4;
+
+struct Job {
+	size_t id;
+	std::string line;
+};
+
+// Per-worker search state, reused across positions
+struct Worker {
+	TranspositionTable tt;
+	EvalCache evalCache;
+	Position pos;
+	std::vector<PVLine> lines;
+
+	explicit Worker(int hashMb) : tt(hashMb) {}
+};
+
+json pvJson(const std::vector<Move> &moves) {
+	json pv = json::array();
+	for (const Move &m : moves)
+		pv.push_back(MoveToUci(m));
+	return pv;
+}
+
+std::string analyzeLine(const BatchAnalysisOptions &opts, int maxDepth, Worker &w,
+                        const Job &job) {
+	json out{{"id", job.id}};
+	if (!w.pos.setFromFEN(job.line)) {
+		out["error"] = "invalid fen";
+		out["input"] = job.line;
+		return out.dump();
+	}
+	out["fen"] = w.pos.toFEN();
+
+	SearchContext ctx;
+	ctx.tt = &w.tt;
+	ctx.evalCache = &w.evalCache;
+	ctx.limits.maxNodes = opts.nodes;
+	auto start = std::chrono::steady_clock::now();
+	if (opts.timeMs > 0) {
+		ctx.limits.useTime = true;
+		ctx.limits.endTime = start + std::chrono::milliseconds(opts.timeMs);
+	}
+
+	const int multiPV = std::clamp(opts.multiPV, 1, MAX_MULTIPV);
+	if (!searchMultiPV(w.pos, maxDepth, multiPV, ctx, w.lines) || w.lines.empty()) {
+		out["bestmove"] = nullptr;
+	} else {
+		const PVLine &best = w.lines.front();
+		out["bestmove"] = MoveToUci(best.moves.front());
+		out["score"] = best.score;
+		out["depth"] = best.depth;
+		out["pv"] = pvJson(best.moves);
+		if (multiPV > 1) {
+			json lines = json::array();
+			for (const PVLine &line : w.lines)
+				lines.push_back(
+				    {{"depth", line.depth}, {"score", line.score}, {"pv", pvJson(line.moves)}});
+			out["lines"] = lines;
+		}
+	}
+	out["nodes"] = ctx.stats.nodes;
+	out["time_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+	                     std::chrono::steady_clock::now() - start)
+	                     .count();
+	return out.dump();
+}
+
+} // namespace
+
+int runBatchAnalysis(const BatchAnalysisOptions &opts) {
+	std::ifstream file;
+	if (!opts.inputPath.empty()) {
+		file.open(opts.inputPath);
+		if (!file) {
+			std::cerr << "Cannot open " << opts.inputPath << "\n";
+			return 1;
+		}
+	}
+	std::istream &in = opts.inputPath.empty() ? std::cin : file;
+
+	const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+	const int threads = opts.threads > 0 ? opts.threads : std::max(1, hardware);
+	const bool limited = opts.nodes > 0 || opts.timeMs > 0;
+	const int maxDepth = opts.depth > 0 ? opts.depth : limited ? UNLIMITED_DEPTH : DEFAULT_DEPTH;
+	const size_t window = IN_FLIGHT_PER_WORKER * threads;
+
+	// Jobs wait in queue, finished results in done until every earlier id has been written
+	std::mutex mutex;
+	std::condition_variable jobReady, slotFree;
+	std::deque<Job> queue;
+	std::map<size_t, std::string> done;
+	size_t nextWrite = 0;
+	bool inputDone = false;
+
+	auto work = [&]() {
+		Worker w(opts.hashMb);
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobReady.wait(lock, [&] { return !queue.empty() || inputDone; });
+				if (queue.empty())
+					return;
+				job = std::move(queue.front());
+				queue.pop_front();
+			}
+			std::string result = analyzeLine(opts, maxDepth, w, job);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			done.emplace(job.id, std::move(result));
+			while (!done.empty() && done.begin()->first == nextWrite) {
+				std::cout << done.begin()->second << "\n";
+				done.erase(done.begin());
+				++nextWrite;
+			}
+			std::cout.flush();
+			slotFree.notify_one();
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (int t = 0; t < threads; ++t)
+		pool.emplace_back(work);
+
+	size_t id = 0;
+	for (std::string line; std::getline(in, line);) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (line.empty())
+			continue;
+		std::unique_lock<std::mutex> lock(mutex);
+		slotFree.wait(lock, [&] { return id - nextWrite < window; });
+		queue.push_back({id++, std::move(line)});
+		jobReady.notify_one();
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		inputDone = true;
+	}
+	jobReady.notify_all();
+	for (auto &th : pool)
+		th.join();
+	return 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "types.h"
+#include <string>
+
+struct BatchAnalysisOptions {
+	std::string inputPath; // FEN/EPD lines; standard input when empty
+	int depth = 0;         // 0 is unlimited with a node or time limit, else 10
+	u64 nodes = 0;         // per position, 0 for no limit
+	int timeMs = 0;        // per position, 0 for no limit
+	int multiPV = 1;
+	int threads = 0; // 0 uses every hardware thread
+	int hashMb = 16; // per worker
+};
+
+// Search every position of the input on a pool of workers, each with its own transposition
+// table and evaluation cache, and write one JSON object per input line to standard output in
+// input order. At most a few positions per worker are in flight, so memory stays bounded for
+// any input size. Returns a process exit code.
+int runBatchAnalysis(const BatchAnalysisOptions &opts);
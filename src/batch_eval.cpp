@@ -0,0 +1,165 @@
+#include "batch_eval.h"
+#include "epd_reader.h"
+#include "eval_params.h"
+#include "evaluate.h"
+#include "mapped_file.h"
+#include "nnue.h"
+#include "psqt.h"
+#include "search.h"
+#include "training_data.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr size_t BLOCK_BYTES = 32 << 20;
+
+// Term groups are the evalTermName prefixes: "material", "psqt", "passed", ...
+const std::vector<std::string> &termGroups() {
+	static const std::vector<std::string> groups = [] {
+		std::vector<std::string> g(EVAL_TERMS);
+		for (int term = 0; term < EVAL_TERMS; ++term) {
+			std::string name = evalTermName(term);
+			g[term] = name.substr(0, name.find('.'));
+		}
+		return g;
+	}();
+	return groups;
+}
+
+// Middlegame and endgame sums per term group, from the side to move's point of view
+json termsJson(const Position &pos) {
+	EvalTrace trace;
+	traceEvaluation(pos, trace);
+	const int sign = pos.sideToMove == WHITE ? 1 : -1;
+	std::map<std::string, std::pair<int, int>> sums;
+	for (int term = 0; term < EVAL_TERMS; ++term) {
+		if (!trace.coef[term])
+			continue;
+		auto &sum = sums[termGroups()[term]];
+		sum.first += sign * trace.coef[term] * paramMg(term);
+		sum.second += sign * trace.coef[term] * paramEg(term);
+	}
+	json terms = json::object();
+	for (const auto &[group, sum] : sums)
+		terms[group] = {{"mg", sum.first}, {"eg", sum.second}};
+	return json{{"phase", trace.phase}, {"max_phase", MAX_PHASE}, {"groups", terms}};
+}
+
+struct Evaluator {
+	const BatchEvalOptions &opts;
+	Position pos;
+
+	// Append the result for one line to out; returns false if the line is not a position
+	bool run(std::string_view line, std::string &out) {
+		if (!pos.setFromFEN(line)) {
+			if (!opts.binary)
+				out += json{{"error", "invalid fen"}, {"input", line}}.dump() + "\n";
+			return false;
+		}
+		int score;
+		if (opts.quiescence) {
+			SearchContext ctx;
+			score = quiescence(pos, -MATE_SCORE, MATE_SCORE, ctx);
+		} else {
+			score = evaluate(pos);
+		}
+
+		if (opts.binary) {
+			TrainingRecord r = makeTrainingRecord(pos, score, 0);
+			out.append(reinterpret_cast<const char *>(&r), sizeof(r));
+			return true;
+		}
+		json j{{"fen", pos.toFEN()}, {"eval", score}};
+		if (opts.terms)
+			j["terms"] = termsJson(pos);
+		out += j.dump() + "\n";
+		return true;
+	}
+};
+
+} // namespace
+
+int runBatchEval(const BatchEvalOptions &opts) {
+	if (opts.terms && Nnue::isLoaded()) {
+		std::cerr << "Term breakdowns are for the classical evaluation; run without --eval-file\n";
+		return 1;
+	}
+
+	MappedFile file;
+	if (!opts.inputPath.empty() && !file.open(opts.inputPath)) {
+		std::cerr << "Cannot open " << opts.inputPath << "\n";
+		return 1;
+	}
+	FILE *out = opts.outputPath.empty() ? stdout : std::fopen(opts.outputPath.c_str(), "wb");
+	if (!out) {
+		std::cerr << "Cannot write " << opts.outputPath << "\n";
+		return 1;
+	}
+
+	const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+	const int threads = opts.threads > 0 ? opts.threads : std::max(1, hardware);
+	size_t positions = 0, rejected = 0;
+	bool writeFailed = false;
+
+	// Split a block of whole lines across the workers and write their output in order
+	auto processBlock = [&](std::string_view block) {
+		const std::vector<std::string_view> chunks = splitLineChunks(block, threads * 4);
+		std::vector<std::string> outputs(chunks.size());
+		std::vector<size_t> good(chunks.size(), 0), bad(chunks.size(), 0);
+		forEachChunk(chunks, threads, [&](size_t c, std::string_view chunk) {
+			Evaluator evaluator{opts, Position()};
+			forEachLine(chunk, [&](std::string_view line) {
+				++(evaluator.run(line, outputs[c]) ? good[c] : bad[c]);
+			});
+		});
+		for (size_t c = 0; c < chunks.size(); ++c) {
+			writeFailed |= std::fwrite(outputs[c].data(), 1, outputs[c].size(), out) !=
+			               outputs[c].size();
+			positions += good[c];
+			rejected += bad[c];
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	if (file.isOpen()) {
+		const std::string_view text(file.data(), file.size());
+		for (std::string_view block : splitLineChunks(text, text.size() / BLOCK_BYTES + 1))
+			processBlock(block);
+	} else {
+		// Read standard input in blocks, carrying a partial last line over to the next block
+		std::string buffer;
+		std::vector<char> chunk(BLOCK_BYTES);
+		while (true) {
+			size_t n = std::fread(chunk.data(), 1, chunk.size(), stdin);
+			buffer.append(chunk.data(), n);
+			const size_t newline = buffer.rfind('\n');
+			const size_t end = n == 0                        ? buffer.size()
+			                   : newline == std::string::npos ? 0
+			                                                  : newline + 1;
+			if (end > 0) {
+				processBlock(std::string_view(buffer.data(), end));
+				buffer.erase(0, end);
+			}
+			if (n == 0)
+				break;
+		}
+	}
+	const bool closed = out == stdout ? std::fflush(out) == 0 : std::fclose(out) == 0;
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::fprintf(stderr, "Evaluated %zu positions (%zu rejected) in %.2fs, %.0f positions/s\n",
+	             positions, rejected, secs, positions / std::max(secs, 1e-9));
+	if (writeFailed || !closed) {
+		std::cerr << "Write failed\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+
+struct BatchEvalOptions {
+	std::string inputPath;  // FEN/EPD lines; standard input when empty
+	std::string outputPath; // standard output when empty
+	bool quiescence = false; // resolve captures before evaluating
+	bool binary = false;     // TrainingRecords with the eval as score instead of JSON lines
+	bool terms = false;      // add the classical evaluation broken down by term group
+	int threads = 0;         // 0 uses every hardware thread
+};
+
+// Evaluate every position of the input without a search, from the side to move's point of
+// view. Input is processed in blocks of whole lines, each split across the workers and written
+// in input order, so memory stays bounded. Lines that are not positions become error objects
+// in JSON output and are skipped in binary output. Returns a process exit code.
+int runBatchEval(const BatchEvalOptions &opts);
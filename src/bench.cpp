@@ -0,0 +1,143 @@
+#include "bench.h"
+#include "search.h"
+#include "evaluate.h"
+#include "movegen.h"
+#include "nnue.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+static const std::vector<const char *> BenchPositions = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "2r3k1/pp3ppp/2n1p3/3pP3/3P4/P4N2/1P3PPP/2R3K1 b - - 0 1",
+    "6k1/5pp1/7p/8/2P5/1P3PK1/6PP/8 w - - 0 1",
+};
+
+struct BenchTotals {
+	SearchStats stats;
+	double seconds = 0.0;
+};
+
+static BenchTotals benchRun(int depth, bool useEvalCache) {
+	BenchTotals totals;
+	TranspositionTable tt(16);
+	EvalCache evalCache(1);
+
+	for (const char *fen : BenchPositions) {
+		Position pos;
+		if (!pos.setFromFEN(fen)) {
+			std::cerr << "bench: bad FEN " << fen << "\n";
+			continue;
+		}
+		tt.clear();
+		evalCache.clear();
+
+		SearchContext ctx;
+		ctx.tt = &tt;
+		ctx.evalCache = useEvalCache ? &evalCache : nullptr;
+
+		auto start = std::chrono::steady_clock::now();
+		Move best{};
+		searchBestMove(pos, depth, ctx, best);
+		totals.seconds +=
+		    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		totals.stats.nodes += ctx.stats.nodes;
+		totals.stats.evalProbes += ctx.stats.evalProbes;
+		totals.stats.evalHits += ctx.stats.evalHits;
+		totals.stats.ttProbes += ctx.stats.ttProbes;
+		totals.stats.ttHits += ctx.stats.ttHits;
+		totals.stats.pawnProbes += ctx.stats.pawnProbes;
+		totals.stats.pawnHits += ctx.stats.pawnHits;
+	}
+	return totals;
+}
+
+static void printTotals(const char *label, const BenchTotals &t) {
+	double nps = t.seconds > 0 ? t.stats.nodes / t.seconds : 0.0;
+	std::printf("%-16s nodes %12llu  time %8.3fs  nps %10.0f  eval hit %5.1f%%  tt hit %5.1f%%  "
+	            "pawn hit %5.1f%%\n",
+	            label, t.stats.nodes, t.seconds, nps, t.stats.evalHitRate() * 100.0,
+	            t.stats.ttHitRate() * 100.0, t.stats.pawnHitRate() * 100.0);
+}
+
+// Evaluate every node of a depth-limited tree walk, the access pattern of a search
+static void evalWalk(Position &pos, int depth, u64 &evals, long long &checksum) {
+	checksum += evaluate(pos);
+	++evals;
+	if (depth == 0)
+		return;
+
+	std::vector<Move> moves;
+	GeneratePseudoLegalMoves(pos, moves);
+	for (const Move &m : moves) {
+		if (!pos.makeMove(m))
+			continue;
+		evalWalk(pos, depth - 1, evals, checksum);
+		pos.undoMove();
+	}
+}
+
+static void benchEval(const char *label) {
+	const Nnue::Stats before = Nnue::threadStats();
+	u64 evals = 0;
+	long long checksum = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (const char *fen : BenchPositions) {
+		Position pos;
+		if (pos.setFromFEN(fen))
+			evalWalk(pos, 3, evals, checksum);
+	}
+	double seconds =
+	    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	const Nnue::Stats &after = Nnue::threadStats();
+	u64 nnueEvals = after.evals - before.evals;
+	u64 refreshes = after.refreshes - before.refreshes;
+	u64 incremental = after.incremental - before.incremental;
+
+	std::printf("%-16s evals %10llu  time %8.3fs  evals/s %11.0f  checksum %lld", label, evals,
+	            seconds, seconds > 0 ? evals / seconds : 0.0, checksum);
+	if (nnueEvals)
+		std::printf("  refresh %5.2f%%  incremental %5.2f%%",
+		            100.0 * refreshes / (2.0 * nnueEvals), 100.0 * incremental / (2.0 * nnueEvals));
+	std::printf("\n");
+}
+
+int runBench(int depth) {
+	std::printf("Bench: %zu positions, depth %d\n", BenchPositions.size(), depth);
+
+	BenchTotals without = benchRun(depth, false);
+	printTotals("no eval cache", without);
+
+	BenchTotals with = benchRun(depth, true);
+	printTotals("eval cache", with);
+
+	if (without.seconds > 0 && with.seconds > 0) {
+		double npsWithout = without.stats.nodes / without.seconds;
+		double npsWith = with.stats.nodes / with.seconds;
+		std::printf("eval cache NPS change: %+.1f%%\n", (npsWith / npsWithout - 1.0) * 100.0);
+	}
+
+	if (!Nnue::isLoaded()) {
+		benchEval("classical eval");
+		return 0;
+	}
+
+	// Same walk with every SIMD kernel set this CPU supports; checksums must agree
+	const std::string active = Nnue::kernelName();
+	for (const char *name : {"scalar", "sse4.1", "avx2"}) {
+		if (!Nnue::selectKernel(name))
+			continue;
+		benchEval((std::string("nnue ") + name).c_str());
+	}
+	Nnue::selectKernel(active);
+	return 0;
+}
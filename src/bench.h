@@ -0,0 +1,5 @@
+#pragma once
+
+// Fixed-depth search over a small position suite. Runs once with and once without the
+// evaluation cache and prints nodes, NPS and hash hit rates for each run.
+int runBench(int depth);
@@ -0,0 +1,154 @@
+#include "chess_api.h"
+#include "engine_session.h"
+#include "perft.h"
+#include "result_cache.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+namespace {
+
+constexpr int MAX_API_DEPTH = 64;
+
+std::string joinUci(const std::vector<Move> &moves) {
+	std::string s;
+	for (const Move &m : moves) {
+		if (!s.empty())
+			s += ' ';
+		s += MoveToUci(m);
+	}
+	return s;
+}
+
+// Copy s with its terminator into buf, or fail without writing anything
+bool copyOut(const std::string &s, char *buf, size_t size) {
+	if (!buf || s.size() + 1 > size)
+		return false;
+	std::memcpy(buf, s.c_str(), s.size() + 1);
+	return true;
+}
+
+} // namespace
+
+struct ChessSession {
+	explicit ChessSession(const EngineConfig &cfg) : session(cfg) {}
+
+	EngineSession session;
+	std::atomic<bool> stop{false};
+};
+
+extern "C" {
+
+int chess_api_version(void) { return CHESS_API_VERSION; }
+
+ChessSession *chess_session_new(int hash_mb) {
+	EngineConfig cfg;
+	if (hash_mb > 0)
+		cfg.hashMb = hash_mb;
+	try {
+		return new ChessSession(cfg);
+	} catch (const std::bad_alloc &) {
+		return nullptr;
+	}
+}
+
+void chess_session_free(ChessSession *session) { delete session; }
+
+void chess_new_game(ChessSession *session) {
+	session->session.newGame(session->session.getHumanColor());
+}
+
+int chess_set_fen(ChessSession *session, const char *fen) {
+	return fen && session->session.setPosition(fen) ? 0 : -1;
+}
+
+int chess_get_fen(const ChessSession *session, char *buf, size_t size) {
+	const std::string fen = session->session.position().toFEN();
+	return copyOut(fen, buf, size) ? static_cast<int>(fen.size()) : -1;
+}
+
+int chess_make_move(ChessSession *session, const char *uci) {
+	Move applied{};
+	std::string error;
+	return uci && session->session.applyHumanMove(uci, applied, error) ? 0 : -1;
+}
+
+int chess_legal_moves(const ChessSession *session, char *buf, size_t size) {
+	const std::vector<Move> &moves = session->session.legalMoves();
+	return copyOut(joinUci(moves), buf, size) ? static_cast<int>(moves.size()) : -1;
+}
+
+int chess_game_status(const ChessSession *session) {
+	return static_cast<int>(session->session.getGameResult());
+}
+
+uint64_t chess_perft(const ChessSession *session, int depth) {
+	Position pos = session->session.position();
+	return Perft(pos, depth);
+}
+
+int chess_search(ChessSession *session, const ChessSearchLimits *limits,
+                 ChessProgressCallback progress, void *user, ChessSearchResult *out) {
+	const auto begin = std::chrono::steady_clock::now();
+
+	SearchLimits searchLimits;
+	searchLimits.stop = &session->stop;
+	searchLimits.maxNodes = limits->nodes;
+	if (limits->time_ms > 0) {
+		searchLimits.useTime = true;
+		searchLimits.endTime = begin + std::chrono::milliseconds(limits->time_ms);
+	}
+	const int depth =
+	    limits->depth > 0 ? std::min(limits->depth, MAX_API_DEPTH) : MAX_API_DEPTH;
+
+	InfoReporter info;
+	if (progress) {
+		info = [&](const SearchInfo &i) {
+			const std::string pv = joinUci(i.pv);
+			const ChessSearchInfo c{i.depth, i.seldepth, i.score, i.nodes,
+			                        i.nps,   i.timeMs,   i.hashfull, pv.c_str()};
+			if (progress(&c, user) != 0)
+				session->stop = true;
+		};
+	}
+
+	std::vector<PVLine> lines;
+	const bool found = session->session.search(depth, searchLimits,
+	                                           std::max(1, limits->multipv), lines, info);
+	// Cleared only now, so a stop that raced ahead of this search still ended it
+	session->stop = false;
+	if (!found && session->session.legalMoves().empty())
+		return -1;
+
+	// Stopped before the first depth finished: report any legal move
+	if (lines.empty())
+		lines.push_back(PVLine{0, 0, {session->session.legalMoves().front()}});
+
+	std::memset(out, 0, sizeof(*out));
+	out->line_count = static_cast<int>(std::min<size_t>(lines.size(), CHESS_MAX_LINES));
+	for (int i = 0; i < out->line_count; ++i) {
+		ChessSearchLine &line = out->lines[i];
+		line.depth = lines[i].depth;
+		line.score = lines[i].score;
+		std::string pv = joinUci(lines[i].moves);
+		// Drop whole moves from the end of a PV too long for the buffer
+		while (pv.size() >= CHESS_PV_SIZE)
+			pv.erase(pv.rfind(' '));
+		std::memcpy(line.pv, pv.c_str(), pv.size() + 1);
+	}
+	const SearchStats &stats = session->session.lastSearchStats();
+	out->nodes = stats.nodes;
+	out->seldepth = stats.seldepth;
+	out->time_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+	                                    std::chrono::steady_clock::now() - begin)
+	                                    .count());
+	return 0;
+}
+
+void chess_session_stop(ChessSession *session) { session->stop = true; }
+
+void chess_set_result_cache(size_t mb) { resultCache().setCapacity(mb * 1024 * 1024); }
+
+} // extern "C"
@@ -0,0 +1,116 @@
+// chess_api.h: C interface of libchess for embedding the engine in other processes
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped whenever a declaration below changes incompatibly
+#define CHESS_API_VERSION 1
+
+// The library is built with hidden symbols; only declarations marked CHESS_API are exported
+#define CHESS_API __attribute__((visibility("default")))
+
+#define CHESS_MAX_LINES 8
+#define CHESS_PV_SIZE 512
+#define CHESS_MOVES_SIZE 2048 // enough for every legal move of any position
+
+// Game status, as in GameResult
+enum {
+	CHESS_ONGOING = 0,
+	CHESS_CHECKMATE = 1,
+	CHESS_STALEMATE = 2,
+	CHESS_REPETITION = 3,
+	CHESS_FIFTY_MOVES = 4,
+	CHESS_INSUFFICIENT_MATERIAL = 5
+};
+
+// A session owns a position and its hash tables. One thread may use a session at a time,
+// except for chess_session_stop; different sessions may be used concurrently.
+typedef struct ChessSession ChessSession;
+
+// Zero fields mean no limit; at least one of depth, time_ms and nodes should be set
+typedef struct ChessSearchLimits {
+	int depth;
+	int time_ms;
+	uint64_t nodes;
+	int multipv; // lines to rank, 0 for 1
+} ChessSearchLimits;
+
+// Progress of a running search. pv is a space separated list of UCI moves that is only valid
+// during the callback.
+typedef struct ChessSearchInfo {
+	int depth;
+	int seldepth;
+	int score; // centipawns for the side to move; +-(100000 - plies) for a mate in that many plies
+	uint64_t nodes;
+	uint64_t nps;
+	int time_ms;
+	int hashfull; // per mille
+	const char *pv;
+} ChessSearchInfo;
+
+// Called on the searching thread at most every 100 ms. A nonzero return stops the search.
+typedef int (*ChessProgressCallback)(const ChessSearchInfo *info, void *user);
+
+typedef struct ChessSearchLine {
+	int depth;
+	int score;
+	char pv[CHESS_PV_SIZE]; // space separated UCI moves, the first is the move to play
+} ChessSearchLine;
+
+typedef struct ChessSearchResult {
+	int line_count; // best first
+	ChessSearchLine lines[CHESS_MAX_LINES];
+	uint64_t nodes;
+	int seldepth;
+	int time_ms;
+} ChessSearchResult;
+
+CHESS_API int chess_api_version(void);
+
+// A session at the start position with a hash_mb transposition table (0 for the default).
+// Returns NULL on failure.
+CHESS_API ChessSession *chess_session_new(int hash_mb);
+CHESS_API void chess_session_free(ChessSession *session);
+
+// Back to the start position with cleared hash tables
+CHESS_API void chess_new_game(ChessSession *session);
+
+// Returns 0, or -1 (position unchanged) for a malformed FEN
+CHESS_API int chess_set_fen(ChessSession *session, const char *fen);
+
+// Writes the FEN and returns its length, or -1 if it does not fit in size bytes
+CHESS_API int chess_get_fen(const ChessSession *session, char *buf, size_t size);
+
+// Plays a UCI move such as "e2e4" or "e7e8q". Returns 0, or -1 if it is not legal.
+CHESS_API int chess_make_move(ChessSession *session, const char *uci);
+
+// Writes the legal moves as space separated UCI and returns their count, or -1 if they do not
+// fit in size bytes (CHESS_MOVES_SIZE always suffices)
+CHESS_API int chess_legal_moves(const ChessSession *session, char *buf, size_t size);
+
+CHESS_API int chess_game_status(const ChessSession *session);
+
+CHESS_API uint64_t chess_perft(const ChessSession *session, int depth);
+
+// Searches the current position without playing a move and ranks the best moves into out.
+// progress may be NULL. Returns 0, or -1 when there is no legal move.
+CHESS_API int chess_search(ChessSession *session, const ChessSearchLimits *limits,
+                 ChessProgressCallback progress, void *user, ChessSearchResult *out);
+
+// Ask a search running on another thread to return its best lines so far. A stop that arrives
+// before the search starts ends it as soon as it starts.
+CHESS_API void chess_session_stop(ChessSession *session);
+
+// Share finished searches between every session of the process in a cache of up to mb
+// megabytes (0, the default, disables it): a search of a position some session already
+// searched as far as its limits allow returns those lines at once, and a shallower result is
+// deepened instead of searched again
+CHESS_API void chess_set_result_cache(size_t mb);
+
+#ifdef __cplusplus
+}
+#endif
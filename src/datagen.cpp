@@ -0,0 +1,106 @@
+#include "datagen.h"
+#include "game_chain.h"
+#include "search.h"
+#include "selfplay.h"
+#include "training_data.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr int PROGRESS_GAMES = 100;
+
+bool keepPosition(const Position &pos, const Move &move, int score) {
+	return !pos.inCheck(pos.sideToMove) && !(move.flags & (MF_CAPTURE | MF_PROMOTION)) &&
+	       !isMateScore(score);
+}
+
+} // namespace
+
+int runDatagen(const DatagenOptions &opts) {
+	TrainingWriter writer(opts.outPath);
+	if (!writer.isOpen()) {
+		std::cerr << "Cannot write " << opts.outPath << "\n";
+		return 1;
+	}
+
+	const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+	const int threads = opts.threads > 0 ? opts.threads : std::max(1, hardware);
+
+	EngineConfig cfg;
+	cfg.hashMb = 2;
+	GameLimits limits;
+	limits.nodes = opts.nodes;
+
+	std::atomic<int> gamesDone{0};
+	std::atomic<size_t> positions{0};
+	std::atomic<bool> failed{false};
+	std::mutex printMutex;
+	const auto start = std::chrono::steady_clock::now();
+
+	auto report = [&]() {
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		double secs = std::chrono::duration<double>(elapsed).count();
+		std::printf("Games %d  positions %zu  %.0f pos/s\n", gamesDone.load(), positions.load(),
+		            positions / std::max(secs, 1e-9));
+		std::fflush(stdout);
+	};
+
+	parallelFor(threads, std::max(0, opts.games), [&](size_t g) {
+		if (failed)
+			return;
+		std::mt19937_64 rng(opts.seed * 1000003ULL + g);
+		Position opening = randomOpening(rng, opts.randomPlies + static_cast<int>(g & 1));
+
+		// Scores are stored now, results once the game is over
+		std::vector<TrainingRecord> records;
+		std::vector<ChainPly> plies;
+		auto observe = [&](const Position &pos, const Move &move, int score) {
+			const bool keep = keepPosition(pos, move, score);
+			if (opts.chain)
+				plies.push_back({move, keep ? static_cast<int16_t>(std::clamp(score, -32000, 32000))
+				                            : CHAIN_NO_SCORE});
+			else if (keep)
+				records.push_back(makeTrainingRecord(pos, score, 0));
+		};
+		GameOutcome outcome = playGame(opening, cfg, cfg, limits, observe);
+
+		const int white = outcome == GameOutcome::WHITE_WIN   ? 1
+		                  : outcome == GameOutcome::BLACK_WIN ? -1
+		                                                      : 0;
+		size_t kept = records.size();
+		bool ok;
+		if (opts.chain) {
+			std::vector<uint8_t> bytes;
+			ok = encodeGameChain(opening, plies, white, bytes) &&
+			     writer.writeBytes(bytes.data(), bytes.size());
+			kept = std::count_if(plies.begin(), plies.end(),
+			                     [](const ChainPly &p) { return p.score != CHAIN_NO_SCORE; });
+		} else {
+			for (TrainingRecord &r : records)
+				r.result = static_cast<int8_t>(r.position.sideToMove() == WHITE ? white : -white);
+			ok = writer.write(records.data(), records.size());
+		}
+		if (!ok)
+			failed = true;
+
+		positions += kept;
+		if (++gamesDone % PROGRESS_GAMES == 0) {
+			std::lock_guard<std::mutex> lock(printMutex);
+			report();
+		}
+	});
+
+	if (!writer.flush() || failed) {
+		std::cerr << "Write to " << opts.outPath << " failed\n";
+		return 1;
+	}
+	report();
+	return 0;
+}
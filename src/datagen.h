@@ -0,0 +1,20 @@
+#pragma once
+#include "types.h"
+#include <string>
+
+struct DatagenOptions {
+	std::string outPath; // TrainingRecords, or game chains with chain set, are appended here
+	bool chain = false;
+	int games = 1000;
+	u64 nodes = 5000;    // per move
+	int threads = 0;     // 0 uses every hardware thread
+	int randomPlies = 8; // random opening moves; every other game plays one more
+	unsigned seed = 1;
+};
+
+// Generate training data from low-node self-play games. Every searched position is kept unless
+// the side to move is in check, the chosen move is a capture or promotion, or the score is a
+// mate score, and is labelled with the search score and the final game result. Games are
+// seeded by index, so the output does not depend on the thread count. Returns a process exit
+// code.
+int runDatagen(const DatagenOptions &opts);
@@ -1,6 +1,9 @@
 // engine_session.cpp
 #include "engine_session.h"
+#include "result_cache.h"
 #include "utils.h" // MoveToString, etc.
+#include <algorithm>
+#include <iostream>
 
 int EngineSession::parseSquare(const std::string& s) const {
     if (s.size() != 2) return -1;
@@ -48,9 +51,6 @@ bool EngineSession::applyHumanMove(const std::string& input, Move& outMove, std:
         }
     }
 
-    std::vector<Move> moves;
-    GenerateLegalMoves(pos, moves);
-
     for (const Move& m : moves) {
         if (m.from == fromSq && m.to == toSq) {
             if ((m.flags & MF_PROMOTION) != 0) {
@@ -64,6 +64,7 @@ bool EngineSession::applyHumanMove(const std::string& input, Move& outMove, std:
                 return false;
             }
             outMove = m;
+            refreshLegalMoves();
             return true;
         }
     }
@@ -72,20 +73,149 @@ bool EngineSession::applyHumanMove(const std::string& input, Move& outMove, std:
     return false;
 }
 
-bool EngineSession::applyEngineMove(Move& outMove) {
-    SearchLimits limits;
-    limits.useTime = true;
-    limits.endTime = std::chrono::steady_clock::now() +
-                     std::chrono::milliseconds(config.thinkTimeMs);
+// A segment that cannot be used leaves the session with the private table from the constructor
+void EngineSession::attachSharedHash() {
+    std::string error;
+    if (!tt.attachShared(config.sharedHash, config.hashMb, &error)) {
+        std::cerr << "Shared hash unavailable, using a private table: " << error << "\n";
+    }
+}
+
+SearchContext EngineSession::makeContext(int timeMs) {
+    SearchContext ctx;
+    ctx.limits.useTime = true;
+    ctx.limits.endTime = std::chrono::steady_clock::now() +
+                         std::chrono::milliseconds(timeMs);
+    ctx.params = config.search;
+    ctx.tt = &tt;
+    ctx.evalCache = evalCache.enabled() ? &evalCache : nullptr;
+    return ctx;
+}
+
+// Whether the game's history can change the search of this position, which the cache key does
+// not cover: a position since the last capture or pawn move occurred twice, so the search
+// would score its next occurrence as a threefold, or the fifty-move rule is within reach.
+static bool dependsOnHistory(const Position& pos, int maxDepth) {
+    if (pos.halfmoveClock + maxDepth >= 100) {
+        return true;
+    }
+    const int n = static_cast<int>(pos.stateStack.size());
+    const int limit = std::min(pos.halfmoveClock, n);
+    std::vector<u64> keys{pos.key};
+    for (int d = 1; d <= limit; ++d) {
+        keys.push_back(pos.stateStack[n - d].key);
+    }
+    std::sort(keys.begin(), keys.end());
+    return std::adjacent_find(keys.begin(), keys.end()) != keys.end();
+}
+
+// searchMultiPV through the process-wide result cache: an entry that already got as far as
+// these limits would is the answer, a shallower one is where the search resumes.
+bool EngineSession::searchCached(int maxDepth, int multiPV, SearchContext& ctx,
+                                 std::vector<PVLine>& lines, const PVReporter& report) {
+    ResultCache& cache = resultCache();
+    if (!cache.enabled() || dependsOnHistory(pos, maxDepth)) {
+        bool found = searchMultiPV(pos, maxDepth, multiPV, ctx, lines, report);
+        lastStats = ctx.stats;
+        return found;
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+    int limitMs = 0;
+    if (ctx.limits.useTime) {
+        limitMs = std::max<int>(1, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                       ctx.limits.endTime - begin).count());
+    }
+
+    ResultCache::Entry cached;
+    if (cache.probe(pos.key, multiPV, cached)) {
+        if (cached.satisfies(maxDepth, limitMs, ctx.limits.maxNodes)) {
+            cache.recordHit();
+            lines = cached.lines;
+            lastStats = SearchStats{};
+            if (report) {
+                report(lines);
+            }
+            return true;
+        }
+        cache.recordSeed();
+        ctx.seed = &cached.lines;
+    }
 
-    Move best{};
-    if (!searchBestMove(pos, config.maxDepth, limits, best)) {
+    bool found = searchMultiPV(pos, maxDepth, multiPV, ctx, lines, report);
+    lastStats = ctx.stats;
+    if (found) {
+        ResultCache::Entry entry;
+        entry.lines = lines;
+        const int elapsedMs = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - begin).count());
+        // A search stopped short of its seed's depth returns the seed, which took the longer
+        entry.timeMs = std::max(cached.timeMs, elapsedMs);
+        entry.nodes = std::max(cached.nodes, ctx.stats.nodes);
+        cache.store(pos.key, multiPV, std::move(entry));
+    }
+    return found;
+}
+
+bool EngineSession::applyEngineMove(Move& outMove, const InfoReporter& info) {
+    SearchContext ctx = makeContext(config.thinkTimeMs);
+    ctx.info = info;
+
+    std::vector<PVLine> lines;
+    if (!searchCached(config.maxDepth, 1, ctx, lines)) {
         return false;
     }
+    const Move best = lines.front().moves.front();
     if (!pos.makeMove(best)) {
         return false;
     }
     outMove = best;
+    refreshLegalMoves();
+    return true;
+}
+
+bool EngineSession::analyze(int multiPV, std::vector<PVLine>& lines, const PVReporter& report,
+                            const InfoReporter& info) {
+    SearchContext ctx = makeContext(config.analysisTimeMs);
+    ctx.info = info;
+
+    return searchCached(config.maxDepth, multiPV, ctx, lines, report);
+}
+
+bool EngineSession::setPosition(const std::string& fen) {
+    Position next;
+    if (!next.setFromFEN(fen)) {
+        return false;
+    }
+    pos = next;
+    refreshLegalMoves();
     return true;
 }
 
+bool EngineSession::search(int maxDepth, const SearchLimits& limits, int multiPV,
+                           std::vector<PVLine>& lines, const InfoReporter& info) {
+    SearchContext ctx = makeContext(0);
+    ctx.limits = limits;
+    ctx.info = info;
+
+    return searchCached(maxDepth, multiPV, ctx, lines);
+}
+
+bool setEngineOption(EngineConfig& cfg, const std::string& name, int value) {
+    if (name == "depth") cfg.maxDepth = value;
+    else if (name == "time") cfg.thinkTimeMs = value;
+    else if (name == "hash") cfg.hashMb = value;
+    else if (name == "evalcache") cfg.evalCacheMb = value;
+    else if (name == "multipv") cfg.multiPV = value;
+    else {
+        for (const SearchParamSpec& spec : SearchParamSpecs) {
+            if (name == spec.name) {
+                cfg.search.*spec.field = value;
+                return true;
+            }
+        }
+        return false;
+    }
+    return true;
+}
@@ -6,49 +6,115 @@
 #include "movegen.h"
 #include "search.h"
 
-enum class GameResult { ONGOING, CHECKMATE, STALEMATE };
+enum class GameResult {
+	ONGOING,
+	CHECKMATE,
+	STALEMATE,
+	REPETITION, // threefold
+	FIFTY_MOVES,
+	INSUFFICIENT_MATERIAL
+};
 
 struct EngineConfig {
 	int maxDepth = 10;
 	int thinkTimeMs = 2000;
+	int multiPV = 3;
+	int analysisTimeMs = 1000;
+	int hashMb = 16;
+	int evalCacheMb = 1; // 0 disables the evaluation cache
+	// Named shared-memory segment holding a transposition table that sessions in other
+	// processes use too; empty for a private table
+	std::string sharedHash;
+	SearchParams search;
 };
 
+// Set a config field or search parameter by name: "depth", "time", "hash", "evalcache",
+// "multipv" or any SearchParamSpecs name. Returns false for unknown names. Only the config
+// changes; an engine already built from it resizes its tables itself.
+bool setEngineOption(EngineConfig &cfg, const std::string &name, int value);
+
 class EngineSession {
   public:
-	EngineSession(const EngineConfig &cfg = EngineConfig()) : config(cfg) {
+	EngineSession(const EngineConfig &cfg = EngineConfig())
+	    : config(cfg), tt(cfg.hashMb), evalCache(cfg.evalCacheMb) {
 		pos.setStartPosition();
 		humanColor = WHITE;
+		refreshLegalMoves();
+		if (!cfg.sharedHash.empty())
+			attachSharedHash();
 	}
 
 	void newGame(Color humanSide) {
 		pos.setStartPosition();
 		humanColor = humanSide;
+		tt.clear();
+		refreshLegalMoves();
 	}
 
 	const Position &position() const { return pos; }
+	const EngineConfig &engineConfig() const { return config; }
+
+	const TranspositionTable &hashTable() const { return tt; }
+
+	// Bytes held by the session, dominated by its hash tables. A shared table is not counted.
+	size_t memoryUsage() const {
+		return sizeof(*this) + (tt.isShared() ? 0 : tt.bytes()) + evalCache.bytes() +
+		       pos.stateStack.capacity() * sizeof(Position::State) +
+		       moves.capacity() * sizeof(Move);
+	}
 
 	Color sideToMove() const { return pos.sideToMove; }
 	Color getHumanColor() const { return humanColor; }
 
+	// Legal moves of the current position, generated once per position
+	const std::vector<Move> &legalMoves() const { return moves; }
+
 	GameResult getGameResult() const {
-		std::vector<Move> moves;
-		GenerateLegalMoves(pos, moves);
-		if (!moves.empty())
-			return GameResult::ONGOING;
-		bool inCheck = pos.inCheck(pos.sideToMove);
-		return inCheck ? GameResult::CHECKMATE : GameResult::STALEMATE;
+		if (moves.empty())
+			return pos.inCheck(pos.sideToMove) ? GameResult::CHECKMATE : GameResult::STALEMATE;
+		if (pos.isFiftyMoveDraw())
+			return GameResult::FIFTY_MOVES;
+		if (pos.isRepetition())
+			return GameResult::REPETITION;
+		if (pos.isInsufficientMaterial())
+			return GameResult::INSUFFICIENT_MATERIAL;
+		return GameResult::ONGOING;
 	}
 
 	// Parse "e2e4", "e7e8q" into a legal Move and apply it
 	bool applyHumanMove(const std::string &moveStr, Move &appliedMove, std::string &error);
 
-	// Search and apply engine move
-	bool applyEngineMove(Move &appliedMove);
+	// Replace the position and its history; false (position unchanged) for a malformed FEN
+	bool setPosition(const std::string &fen);
+
+	// Search the current position within limits, up to maxDepth, without playing a move
+	bool search(int maxDepth, const SearchLimits &limits, int multiPV, std::vector<PVLine> &lines,
+	            const InfoReporter &info = nullptr);
+
+	// Search and apply engine move, reporting progress to info if given
+	bool applyEngineMove(Move &appliedMove, const InfoReporter &info = nullptr);
+
+	// Rank the best multiPV moves of the current position without playing any of them
+	bool analyze(int multiPV, std::vector<PVLine> &lines, const PVReporter &report = nullptr,
+	             const InfoReporter &info = nullptr);
+
+	// Counters from the most recent engine move or analysis
+	const SearchStats &lastSearchStats() const { return lastStats; }
 
   private:
 	EngineConfig config;
 	Position pos;
 	Color humanColor;
+	SearchStats lastStats;
+	TranspositionTable tt;
+	EvalCache evalCache;
+	std::vector<Move> moves; // legal moves of pos
+
+	SearchContext makeContext(int timeMs);
+	void attachSharedHash();
+	bool searchCached(int maxDepth, int multiPV, SearchContext &ctx, std::vector<PVLine> &lines,
+	                  const PVReporter &report = nullptr);
+	void refreshLegalMoves() { GenerateLegalMoves(pos, moves); }
 
 	int parseSquare(const std::string &s) const;
 	int promotionFromChar(char c, Color side) const;
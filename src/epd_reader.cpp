@@ -0,0 +1,74 @@
+#include "epd_reader.h"
+#include "mapped_file.h"
+#include "position.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+std::vector<std::string_view> splitLineChunks(std::string_view text, size_t count) {
+	std::vector<std::string_view> chunks;
+	// Every piece but the last is at least target bytes, so rounding up keeps it to count
+	const size_t pieces = std::max<size_t>(1, count);
+	const size_t target = std::max<size_t>(1, (text.size() + pieces - 1) / pieces);
+	size_t begin = 0;
+	while (begin < text.size()) {
+		size_t end = std::min(text.size(), begin + target);
+		if (end < text.size()) {
+			size_t newline = text.find('\n', end - 1);
+			end = newline == std::string_view::npos ? text.size() : newline + 1;
+		}
+		chunks.push_back(text.substr(begin, end - begin));
+		begin = end;
+	}
+	return chunks;
+}
+
+void forEachChunk(const std::vector<std::string_view> &chunks, int threads,
+                  const std::function<void(size_t, std::string_view)> &fn) {
+	std::atomic<size_t> next{0};
+	auto worker = [&]() {
+		for (size_t i = next++; i < chunks.size(); i = next++)
+			fn(i, chunks[i]);
+	};
+
+	std::vector<std::thread> pool;
+	for (int t = 1; t < threads; ++t)
+		pool.emplace_back(worker);
+	worker();
+	for (auto &th : pool)
+		th.join();
+}
+
+int runEpdScan(const std::string &path, int threads) {
+	MappedFile file;
+	if (!file.open(path)) {
+		std::cerr << "Cannot open " << path << "\n";
+		return 1;
+	}
+	const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+	threads = threads > 0 ? threads : std::max(1, hardware);
+
+	auto start = std::chrono::steady_clock::now();
+	const std::string_view text(file.data(), file.size());
+	std::atomic<size_t> lines{0}, valid{0};
+	forEachChunk(splitLineChunks(text, threads * 16), threads, [&](size_t, std::string_view chunk) {
+		Position pos;
+		size_t seen = 0, parsed = 0;
+		forEachLine(chunk, [&](std::string_view line) {
+			++seen;
+			parsed += pos.setFromFEN(line);
+		});
+		lines += seen;
+		valid += parsed;
+	});
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	secs = std::max(secs, 1e-9);
+
+	std::printf("Lines %zu  positions %zu  %.2fs  %d threads\n", lines.load(), valid.load(), secs,
+	            threads);
+	std::printf("%.0f lines/s  %.1f MB/s\n", lines / secs, file.size() / secs / 1e6);
+	return 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Line-oriented parsing of large EPD/FEN files held in a MappedFile. Lines are string_views into
+// the mapping, so nothing is copied or allocated per line; Position::setFromFEN takes them
+// directly and ignores any EPD operations after the FEN fields.
+
+// Split text into at most count pieces that each end after a newline (or at the end of text),
+// in file order
+std::vector<std::string_view> splitLineChunks(std::string_view text, size_t count);
+
+// Call fn for every non-empty line of text, without its "\n" or "\r\n" terminator
+template <typename Fn> void forEachLine(std::string_view text, Fn fn) {
+	const char *p = text.data();
+	const char *end = p + text.size();
+	while (p < end) {
+		const auto *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+		const char *lineEnd = newline ? newline : end;
+		size_t length = lineEnd - p;
+		if (length > 0 && p[length - 1] == '\r')
+			--length;
+		if (length > 0)
+			fn(std::string_view(p, length));
+		p = lineEnd + 1;
+	}
+}
+
+// Run fn(i, chunks[i]) for every chunk on threads worker threads, handing out chunks in order
+void forEachChunk(const std::vector<std::string_view> &chunks, int threads,
+                  const std::function<void(size_t, std::string_view)> &fn);
+
+// Parse every line of an EPD file as a position and print lines/s and MB/s. Returns a process
+// exit code.
+int runEpdScan(const std::string &path, int threads);
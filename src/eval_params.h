@@ -0,0 +1,48 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Classical evaluation weights as one parameter vector. Each term has a middlegame and an
+// endgame weight, stored at evalParams[2 * term] and evalParams[2 * term + 1]; the evaluation
+// is linear in them apart from the phase blend.
+//
+// Terms, all from White's point of view:
+//   TERM_MATERIAL + (pieceType - WP)             pawn .. queen
+//   TERM_PSQT + (pieceType - WP) * 64 + sq64     pawn .. king, a1 = 0, h8 = 63
+//   TERM_DOUBLED .. TERM_PHALANX                 per pawn
+//   TERM_PASSED + relative rank                  per passed pawn
+//   TERM_BLOCKED_PASSER                          passed pawn with its stop square occupied
+static constexpr int TERM_MATERIAL = 0;
+static constexpr int TERM_PSQT = TERM_MATERIAL + 5;
+static constexpr int TERM_DOUBLED = TERM_PSQT + 6 * 64;
+static constexpr int TERM_ISOLATED = TERM_DOUBLED + 1;
+static constexpr int TERM_BACKWARD = TERM_ISOLATED + 1;
+static constexpr int TERM_SUPPORTED = TERM_BACKWARD + 1;
+static constexpr int TERM_PHALANX = TERM_SUPPORTED + 1;
+static constexpr int TERM_PASSED = TERM_PHALANX + 1;
+static constexpr int TERM_BLOCKED_PASSER = TERM_PASSED + 8;
+static constexpr int EVAL_TERMS = TERM_BLOCKED_PASSER + 1;
+static constexpr int EVAL_PARAMS = 2 * EVAL_TERMS;
+
+extern std::array<int, EVAL_PARAMS> evalParams;
+
+inline int paramMg(int term) { return evalParams[2 * term]; }
+inline int paramEg(int term) { return evalParams[2 * term + 1]; }
+
+// Number of times each term applies to White minus to Black in one position, plus the game
+// phase. With the current parameters, (mg * phase + eg * (MAX_PHASE - phase)) / MAX_PHASE over
+// the terms reproduces the classical evaluation.
+struct EvalTrace {
+	int8_t coef[EVAL_TERMS] = {};
+	int phase = 0;
+};
+
+// Stable text name of a term, e.g. "material.knight", "psqt.rook.e4", "passed.6"
+std::string evalTermName(int term);
+
+// Parameter files hold one "name mg eg" line per term; unknown names are rejected, missing
+// ones keep their current value. Loading also rebuilds the piece-square tables, so do it
+// before setting up positions.
+bool loadEvalParams(const std::string &path, std::string *error = nullptr);
+bool saveEvalParams(const std::string &path);
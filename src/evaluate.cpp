@@ -0,0 +1,61 @@
+#include "evaluate.h"
+#include "eval_params.h"
+#include "nnue.h"
+#include "pawns.h"
+#include "psqt.h"
+#include <algorithm>
+
+// Passed pawns of each side whose stop square is occupied, White minus Black
+static int blockedPassers(const Position &pos, const PawnEntry &pawns) {
+	int count = 0;
+	for (int c = WHITE; c <= BLACK; ++c) {
+		const int sign = (c == WHITE) ? 1 : -1;
+		for (u64 b = pawns.passed[c]; b; b &= b - 1) {
+			int idx = __builtin_ctzll(b);
+			int stop = Position::makeSquare(idx & 7, (idx >> 3) + sign);
+			if (pos.board[stop] != EMPTY)
+				count += sign;
+		}
+	}
+	return count;
+}
+
+int evaluate(const Position &pos) {
+	if (Nnue::isLoaded())
+		return Nnue::evaluate(pos);
+
+	const PawnEntry &pawns = threadPawnTable().probe(pos);
+	const int blocked = blockedPassers(pos, pawns);
+
+	int mg = pos.psqtMg + pawns.mg + blocked * paramMg(TERM_BLOCKED_PASSER);
+	int eg = pos.psqtEg + pawns.eg + blocked * paramEg(TERM_BLOCKED_PASSER);
+
+	int mgPhase = std::min(pos.phase, MAX_PHASE);
+	int egPhase = MAX_PHASE - mgPhase;
+	int score = (mg * mgPhase + eg * egPhase) / MAX_PHASE;
+
+	// Score from POV of side to move
+	return pos.sideToMove == WHITE ? score : -score;
+}
+
+void traceEvaluation(const Position &pos, EvalTrace &trace) {
+	trace = EvalTrace{};
+	for (int rank = 0; rank < 8; ++rank) {
+		for (int file = 0; file < 8; ++file) {
+			int p = pos.board[Position::makeSquare(file, rank)];
+			if (p == EMPTY)
+				continue;
+			int pt = pieceType(p);
+			int sign = pieceColor(p) == WHITE ? 1 : -1;
+			int sq64 = (sign > 0 ? rank : 7 - rank) * 8 + file;
+			if (pt != WK)
+				trace.coef[TERM_MATERIAL + pt - WP] += sign;
+			trace.coef[TERM_PSQT + (pt - WP) * 64 + sq64] += sign;
+		}
+	}
+
+	PawnEntry pawns;
+	evaluatePawns(pos, pawns, &trace);
+	trace.coef[TERM_BLOCKED_PASSER] = static_cast<int8_t>(blockedPassers(pos, pawns));
+	trace.phase = std::min(pos.phase, MAX_PHASE);
+}
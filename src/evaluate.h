@@ -0,0 +1,13 @@
+#pragma once
+#include "position.h"
+
+// Static evaluation from the side to move's point of view. Blends the incrementally kept
+// middlegame and endgame scores of the position by game phase, plus pawn structure terms
+// served from the per-thread pawn hash table. Uses the NNUE network instead when one is loaded.
+int evaluate(const Position &pos);
+
+struct EvalTrace;
+
+// Count the classical evaluation terms that apply to pos, for tuning. Always White's point of
+// view and independent of any loaded network.
+void traceEvaluation(const Position &pos, EvalTrace &trace);
@@ -0,0 +1,174 @@
+#include "framing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr size_t MAX_FRAME = 64 << 20;
+
+} // namespace
+
+bool parseWireFormat(std::string_view name, WireFormat &format) {
+	if (name == "json")
+		format = WireFormat::JSON_LINES;
+	else if (name == "cbor")
+		format = WireFormat::CBOR;
+	else if (name == "msgpack")
+		format = WireFormat::MSGPACK;
+	else
+		return false;
+	return true;
+}
+
+const char *wireFormatName(WireFormat format) {
+	switch (format) {
+	case WireFormat::CBOR:
+		return "cbor";
+	case WireFormat::MSGPACK:
+		return "msgpack";
+	default:
+		return "json";
+	}
+}
+
+std::string encodeMessage(const json &message, WireFormat format) {
+	if (format == WireFormat::JSON_LINES)
+		return message.dump() + "\n";
+
+	std::string frame(4, '\0');
+	if (format == WireFormat::CBOR)
+		json::to_cbor(message, frame);
+	else
+		json::to_msgpack(message, frame);
+	const uint32_t length = static_cast<uint32_t>(frame.size() - 4);
+	for (int i = 0; i < 4; ++i)
+		frame[i] = static_cast<char>(length >> (24 - 8 * i));
+	return frame;
+}
+
+bool writeAll(int fd, const std::string &data) {
+	for (size_t done = 0; done < data.size();) {
+		ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+		if (n <= 0)
+			return false;
+		done += static_cast<size_t>(n);
+	}
+	return true;
+}
+
+bool MessageReader::fill() {
+	if (start > 0) {
+		buffer.erase(0, start);
+		start = 0;
+	}
+	char chunk[1 << 16];
+	ssize_t n = ::read(fd, chunk, sizeof(chunk));
+	if (n <= 0)
+		return false;
+	buffer.append(chunk, static_cast<size_t>(n));
+	return true;
+}
+
+MessageReader::Result MessageReader::next(WireFormat format, json &message) {
+	if (format == WireFormat::JSON_LINES) {
+		while (true) {
+			size_t end = buffer.find('\n', start);
+			if (end == std::string::npos) {
+				if (fill())
+					continue;
+				if (start == buffer.size())
+					return END;
+				end = buffer.size(); // last line without a newline
+			}
+			std::string_view line(buffer.data() + start, end - start);
+			start = std::min(end + 1, buffer.size());
+			if (!line.empty() && line.back() == '\r')
+				line.remove_suffix(1);
+			if (line.empty())
+				continue;
+			message = json::parse(line, nullptr, false);
+			return message.is_discarded() ? INVALID : MESSAGE;
+		}
+	}
+
+	while (buffer.size() - start < 4)
+		if (!fill())
+			return END;
+	const auto *p = reinterpret_cast<const unsigned char *>(buffer.data() + start);
+	const size_t length =
+	    (size_t(p[0]) << 24) | (size_t(p[1]) << 16) | (size_t(p[2]) << 8) | size_t(p[3]);
+	if (length > MAX_FRAME)
+		return END;
+	while (buffer.size() - start < 4 + length)
+		if (!fill())
+			return END;
+
+	const auto *payload = reinterpret_cast<const uint8_t *>(buffer.data() + start + 4);
+	message = format == WireFormat::CBOR ? json::from_cbor(payload, payload + length, true, false)
+	                                     : json::from_msgpack(payload, payload + length, true, false);
+	start += 4 + length;
+	return message.is_discarded() ? INVALID : MESSAGE;
+}
+
+bool negotiateWireFormat(const json &req, WireFormat &format, json &reply) {
+	if (!req.is_object() || req.value("cmd", "") != "hello")
+		return false;
+	WireFormat requested = WireFormat::JSON_LINES;
+	auto name = req.find("format");
+	if (name != req.end() &&
+	    !(name->is_string() && parseWireFormat(name->get<std::string>(), requested))) {
+		reply = json{{"event", "error"}, {"message", "unknown format"}};
+		return true;
+	}
+	format = requested;
+	reply = json{{"event", "hello"}, {"format", wireFormatName(format)}};
+	return true;
+}
+
+int runFramingBench(int count) {
+	// Shaped like an analysis response with three ten-move lines
+	json lines = json::array();
+	for (int rank = 1; rank <= 3; ++rank) {
+		json pv = json::array();
+		for (int i = 0; i < 10; ++i)
+			pv.push_back(i % 2 ? "e7e5" : "g1f3");
+		lines.push_back({{"rank", rank}, {"depth", 12}, {"score", 35 - rank}, {"pv", pv}});
+	}
+	const json message{{"event", "analysis"},
+	                   {"id", 12345},
+	                   {"fen", "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3"},
+	                   {"side_to_move", "w"},
+	                   {"status", "ongoing"},
+	                   {"lines", lines},
+	                   {"stats", {{"nodes", 1234567}, {"tt_hit_rate", 0.4321}}}};
+
+	std::printf("%d round trips of a %zu-byte JSON analysis message\n", count,
+	            message.dump().size());
+	for (WireFormat format : {WireFormat::JSON_LINES, WireFormat::CBOR, WireFormat::MSGPACK}) {
+		size_t bytes = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; ++i) {
+			std::string wire = encodeMessage(message, format);
+			bytes += wire.size();
+			json decoded;
+			if (format == WireFormat::JSON_LINES)
+				decoded = json::parse(std::string_view(wire).substr(0, wire.size() - 1));
+			else if (format == WireFormat::CBOR)
+				decoded = json::from_cbor(wire.begin() + 4, wire.end());
+			else
+				decoded = json::from_msgpack(wire.begin() + 4, wire.end());
+			if (decoded.size() != message.size())
+				return 1;
+		}
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		double secs = std::chrono::duration<double>(elapsed).count();
+		std::printf("%-8s %6zu bytes/msg  %9.0f msgs/s\n", wireFormatName(format),
+		            bytes / std::max(count, 1), count / std::max(secs, 1e-9));
+	}
+	return 0;
+}
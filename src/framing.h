@@ -0,0 +1,44 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+
+// Message framing for the engine protocols. Sessions start in JSON lines; a first request of
+// {"cmd": "hello", "format": "cbor" | "msgpack"} is answered with {"event": "hello", ...} in
+// JSON lines, after which both directions switch to frames of a 4-byte big-endian payload
+// length followed by the CBOR or MessagePack encoding of the message.
+
+enum class WireFormat { JSON_LINES, CBOR, MSGPACK };
+
+bool parseWireFormat(std::string_view name, WireFormat &format);
+const char *wireFormatName(WireFormat format);
+
+std::string encodeMessage(const nlohmann::json &message, WireFormat format);
+
+// Write all of data to fd; false once the other end is gone
+bool writeAll(int fd, const std::string &data);
+
+// Buffered reader of framed messages from a file descriptor
+class MessageReader {
+  public:
+	enum Result { MESSAGE, INVALID, END };
+
+	explicit MessageReader(int fd) : fd(fd) {}
+
+	// Next message in the given format. INVALID skips one unparseable line or frame; END is
+	// returned at end of input or when a frame length cannot be trusted.
+	Result next(WireFormat format, nlohmann::json &message);
+
+  private:
+	int fd;
+	std::string buffer;
+	size_t start = 0;
+
+	bool fill();
+};
+
+// If req is a start-up hello, pick its format and return the reply to send in JSON lines
+bool negotiateWireFormat(const nlohmann::json &req, WireFormat &format, nlohmann::json &reply);
+
+// Encode and decode a typical analysis response in every format and print messages per second
+int runFramingBench(int count);
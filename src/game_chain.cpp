@@ -0,0 +1,132 @@
+#include "game_chain.h"
+#include "mapped_file.h"
+#include "movegen.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr size_t HEADER_BYTES = sizeof(PackedPosition) + 4;
+constexpr size_t PLY_BYTES = 3;
+
+template <typename T> void put(std::vector<uint8_t> &out, T value) {
+	const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+	out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T> T get(const char *p) {
+	T value;
+	std::memcpy(&value, p, sizeof(T));
+	return value;
+}
+
+} // namespace
+
+bool encodeGameChain(const Position &start, const std::vector<ChainPly> &plies, int whiteResult,
+                     std::vector<uint8_t> &out) {
+	if (plies.size() > UINT16_MAX)
+		return false;
+	const size_t begin = out.size();
+	put(out, packPosition(start));
+	put(out, static_cast<uint16_t>(plies.size()));
+	put(out, static_cast<int8_t>(whiteResult));
+	put(out, uint8_t{0});
+
+	Position pos = start;
+	std::vector<Move> moves;
+	for (const ChainPly &ply : plies) {
+		GenerateLegalMoves(pos, moves);
+		size_t index = 0;
+		while (index < moves.size() &&
+		       (moves[index].from != ply.move.from || moves[index].to != ply.move.to ||
+		        moves[index].promotion != ply.move.promotion))
+			++index;
+		if (index == moves.size()) {
+			out.resize(begin);
+			return false;
+		}
+		put(out, static_cast<uint8_t>(index));
+		put(out, ply.score);
+		pos.makeMove(moves[index]);
+	}
+	return true;
+}
+
+bool decodeGameChains(const char *data, size_t size, std::vector<TrainingRecord> &records,
+                      size_t *games) {
+	Position pos;
+	std::vector<Move> moves;
+	size_t offset = 0, count = 0;
+	while (offset < size) {
+		if (size - offset < HEADER_BYTES)
+			return false;
+		const auto start = get<PackedPosition>(data + offset);
+		const int plies = get<uint16_t>(data + offset + sizeof(PackedPosition));
+		const int white = get<int8_t>(data + offset + sizeof(PackedPosition) + 2);
+		offset += HEADER_BYTES;
+		if (size - offset < plies * PLY_BYTES || !unpackPosition(start, pos))
+			return false;
+
+		for (int i = 0; i < plies; ++i, offset += PLY_BYTES) {
+			const size_t index = static_cast<uint8_t>(data[offset]);
+			const int16_t score = get<int16_t>(data + offset + 1);
+			if (score != CHAIN_NO_SCORE)
+				records.push_back(
+				    makeTrainingRecord(pos, score, pos.sideToMove == WHITE ? white : -white));
+			GenerateLegalMoves(pos, moves);
+			if (index >= moves.size())
+				return false;
+			pos.makeMove(moves[index]);
+		}
+		++count;
+		if (games)
+			*games = count;
+	}
+	return true;
+}
+
+int runChainInfo(const std::string &path) {
+	MappedFile file;
+	if (!file.open(path)) {
+		std::cerr << "Cannot open " << path << "\n";
+		return 1;
+	}
+
+	using Clock = std::chrono::steady_clock;
+	auto seconds = [](Clock::time_point since) {
+		return std::max(std::chrono::duration<double>(Clock::now() - since).count(), 1e-9);
+	};
+
+	std::vector<TrainingRecord> records;
+	size_t games = 0;
+	auto begin = Clock::now();
+	const bool ok = decodeGameChains(file.data(), file.size(), records, &games);
+	const double chainSecs = seconds(begin);
+	if (!ok)
+		std::cerr << path << " is malformed; reporting the games before the error\n";
+
+	// The same positions as plain records only need unpacking
+	Position pos;
+	size_t unpacked = 0;
+	begin = Clock::now();
+	for (const TrainingRecord &r : records)
+		unpacked += unpackPosition(r.position, pos);
+	const double recordSecs = seconds(begin);
+
+	const double positions = static_cast<double>(records.size());
+	const double recordBytes = positions * sizeof(TrainingRecord);
+	std::printf("Games %zu  positions %zu\n", games, records.size());
+	std::printf("Chain   %12zu bytes  %6.2f bytes/position\n", file.size(),
+	            file.size() / std::max(positions, 1.0));
+	std::printf("Records %12.0f bytes  %6.2f bytes/position  ratio %.2fx\n", recordBytes,
+	            static_cast<double>(sizeof(TrainingRecord)),
+	            recordBytes / std::max<double>(file.size(), 1.0));
+	std::printf("Chain decode   %10.0f positions/s  %8.1f MB/s\n", positions / chainSecs,
+	            file.size() / chainSecs / 1e6);
+	std::printf("Record unpack  %10.0f positions/s  %8.1f MB/s\n", unpacked / recordSecs,
+	            recordBytes / recordSecs / 1e6);
+	return ok ? 0 : 1;
+}
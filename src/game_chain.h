@@ -0,0 +1,35 @@
+#pragma once
+#include "training_data.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Training games stored as move chains instead of independent records. Each game is
+//
+//   PackedPosition start, uint16 ply count, int8 result (White's point of view), uint8 reserved,
+//   then per ply: uint8 index of the move in GenerateLegalMoves order, int16 score
+//
+// with native-endian integers and no padding. The score is from the side to move's point of
+// view, or CHAIN_NO_SCORE for positions that are not training samples. Positions are recovered
+// by replaying the moves with makeMove.
+
+constexpr int16_t CHAIN_NO_SCORE = INT16_MIN;
+
+struct ChainPly {
+	Move move;
+	int16_t score;
+};
+
+// Append one game to out. Returns false, leaving out unchanged, if a move is not legal where it
+// is played or the game is longer than the ply count can hold.
+bool encodeGameChain(const Position &start, const std::vector<ChainPly> &plies, int whiteResult,
+                     std::vector<uint8_t> &out);
+
+// Decode every game in data into one TrainingRecord per scored position. Returns false on
+// truncated or inconsistent data; records decoded before the error are kept.
+bool decodeGameChains(const char *data, size_t size, std::vector<TrainingRecord> &records,
+                      size_t *games = nullptr);
+
+// Decode a chain file and print its compression ratio and decode throughput against the same
+// positions as plain TrainingRecords. Returns a process exit code.
+int runChainInfo(const std::string &path);
@@ -4,16 +4,45 @@
 #include <string>
 #include <vector>
 #include "engine_session.h"
+#include "bench.h"
+#include "nnue.h"
+#include "trainer.h"
+#include "tuner.h"
+#include "spsa.h"
+#include "match.h"
+#include "datagen.h"
+#include "game_chain.h"
+#include "epd_reader.h"
+#include "batch_analysis.h"
+#include "batch_eval.h"
+#include "protocol.h"
+#include "server.h"
+#include "uci.h"
+#include "framing.h"
+#include "eval_params.h"
 #include "../tests/perft_tests.h"
+#include "../tests/packed_position_tests.h"
+#include "../tests/pawn_tests.h"
+#include "../tests/game_chain_tests.h"
+#include "../tests/draw_tests.h"
+#include "../tests/framing_tests.h"
+#include "../tests/server_tests.h"
+#include "../tests/result_cache_tests.h"
+#include "../tests/shared_tt_tests.h"
 #include "utils.h"
-#include <nlohmann/json.hpp>
-
-using json = nlohmann::json;
 
 // Forward declarations
 int runCliGame();
 int runPerft(int depth);
-int runProtocol(); // for web API
+int runTrainCommand(int argc, char *argv[]);
+int runTuneCommand(int argc, char *argv[]);
+int runSpsaCommand(int argc, char *argv[]);
+int runMatchCommand(int argc, char *argv[]);
+int runDatagenCommand(int argc, char *argv[]);
+int runAnalyzeCommand(int argc, char *argv[]);
+int runEvalCommand(int argc, char *argv[]);
+int runProtocolCommand(int argc, char *argv[]);
+int runServerCommand(int argc, char *argv[]);
 
 int runCliGame() {
 	EngineConfig cfg;
@@ -31,6 +60,9 @@ int runCliGame() {
 			return 0;
 		if (line.empty())
 			continue;
+		// GUIs start engines without arguments
+		if (line == "uci")
+			return runUci(line);
 
 		char c = std::tolower(line[0]);
 		if (c == 'w') {
@@ -53,22 +85,30 @@ int runCliGame() {
 		printBoard(session.position(), true);
 
 		auto result = session.getGameResult();
-		if (result != GameResult::ONGOING) {
-			bool in_check = session.position().inCheck(session.position().sideToMove);
-			if (in_check) {
-				std::cout << "Checkmate! "
-				          << (session.sideToMove() == humanColor ? "You lose." : "You win!")
-				          << std::endl;
-			} else {
-				std::cout << "Stalemate. Draw" << std::endl;
-			}
+		if (result == GameResult::CHECKMATE) {
+			std::cout << "Checkmate! "
+			          << (session.sideToMove() == humanColor ? "You lose." : "You win!")
+			          << std::endl;
+			break;
+		} else if (result == GameResult::STALEMATE) {
+			std::cout << "Stalemate. Draw" << std::endl;
+			break;
+		} else if (result == GameResult::REPETITION) {
+			std::cout << "Threefold repetition. Draw" << std::endl;
+			break;
+		} else if (result == GameResult::FIFTY_MOVES) {
+			std::cout << "Fifty-move rule. Draw" << std::endl;
+			break;
+		} else if (result == GameResult::INSUFFICIENT_MATERIAL) {
+			std::cout << "Insufficient material. Draw" << std::endl;
 			break;
 		}
 
 		bool humanToMove = (session.sideToMove() == humanColor);
 
 		if (humanToMove) {
-			std::cout << "Your move (e.g., e2e4, e7e8q for promotion, 'quit' to exit): "
+			std::cout << "Your move (e.g., e2e4, e7e8q for promotion, 'analyze' for hints, 'quit' "
+			             "to exit): "
 			          << std::endl;
 			std::string input;
 			if (!std::getline(std::cin, input))
@@ -79,6 +119,24 @@ int runCliGame() {
 				break;
 			}
 
+			if (input == "analyze") {
+				std::vector<PVLine> lines;
+				session.analyze(cfg.multiPV, lines, [](const std::vector<PVLine> &ranked) {
+					for (size_t i = 0; i < ranked.size(); ++i) {
+						std::cout << "depth " << ranked[i].depth << " multipv " << i + 1
+						          << " score " << ranked[i].score << " pv";
+						for (const Move &m : ranked[i].moves)
+							std::cout << " " << MoveToUci(m);
+						std::cout << "\n";
+					}
+					std::cout.flush();
+				});
+				const SearchStats &st = session.lastSearchStats();
+				std::cout << "nodes " << st.nodes << " pawn hash hit rate "
+				          << st.pawnHitRate() * 100.0 << "%" << std::endl;
+				continue;
+			}
+
 			Move m{};
 			std::string err;
 			if (!session.applyHumanMove(input, m, err)) {
@@ -110,101 +168,355 @@ int runPerft(int depth) {
 	return 0;
 }
 
-static std::string statusToString(GameResult r) {
-	switch (r) {
-	case GameResult::ONGOING:
-		return "ongoing";
-	case GameResult::CHECKMATE:
-		return "checkmate";
-	case GameResult::STALEMATE:
-		return "stalemate";
+int runTrainCommand(int argc, char *argv[]) {
+	const char *usage = "Usage: chess train <records> <out.nnue> [--epochs N] [--batch N] "
+	                    "[--lr X] [--lambda X] [--threads N]\n";
+	if (argc < 4) {
+		std::cerr << usage;
+		return 1;
+	}
+
+	TrainerOptions opts;
+	opts.dataPath = argv[2];
+	opts.outPath = argv[3];
+	for (int i = 4; i + 1 < argc; i += 2) {
+		std::string opt = argv[i];
+		std::string value = argv[i + 1];
+		if (opt == "--epochs")
+			opts.epochs = std::stoi(value);
+		else if (opt == "--batch")
+			opts.batchSize = std::stoi(value);
+		else if (opt == "--lr")
+			opts.learningRate = std::stof(value);
+		else if (opt == "--lambda")
+			opts.lambda = std::stof(value);
+		else if (opt == "--threads")
+			opts.threads = std::stoi(value);
+		else {
+			std::cerr << usage;
+			return 1;
+		}
 	}
-	return "ongoing";
+	return runTrainer(opts);
 }
 
-static json stateJson(const EngineSession &s) {
-	json j;
-	j["event"] = "state";
-	j["fen"] = s.position().toFEN();
-	j["side_to_move"] = (s.sideToMove() == WHITE ? "w" : "b");
-	j["status"] = statusToString(s.getGameResult());
-	return j;
+int runTuneCommand(int argc, char *argv[]) {
+	const char *usage = "Usage: chess tune <positions.epd> <out.params> [--epochs N] [--lr X] "
+	                    "[--k X] [--threads N]\n";
+	if (argc < 4) {
+		std::cerr << usage;
+		return 1;
+	}
+
+	TunerOptions opts;
+	opts.epdPath = argv[2];
+	opts.outPath = argv[3];
+	for (int i = 4; i + 1 < argc; i += 2) {
+		std::string opt = argv[i];
+		std::string value = argv[i + 1];
+		if (opt == "--epochs")
+			opts.epochs = std::stoi(value);
+		else if (opt == "--lr")
+			opts.learningRate = std::stof(value);
+		else if (opt == "--k")
+			opts.k = std::stod(value);
+		else if (opt == "--threads")
+			opts.threads = std::stoi(value);
+		else {
+			std::cerr << usage;
+			return 1;
+		}
+	}
+	return runTuner(opts);
 }
 
-int runProtocol() {
-	EngineConfig cfg;
-	EngineSession session(cfg);
+int runSpsaCommand(int argc, char *argv[]) {
+	const char *usage = "Usage: chess spsa <log> [--iterations N] [--pairs N] [--nodes N] "
+	                    "[--rate X] [--openings file.epd] [--threads N]\n";
+	if (argc < 3) {
+		std::cerr << usage;
+		return 1;
+	}
 
-	std::string line;
-	while (std::getline(std::cin, line)) {
-		if (line.empty())
-			continue;
+	SpsaOptions opts;
+	opts.logPath = argv[2];
+	for (int i = 3; i + 1 < argc; i += 2) {
+		std::string opt = argv[i];
+		std::string value = argv[i + 1];
+		if (opt == "--iterations")
+			opts.iterations = std::stoi(value);
+		else if (opt == "--pairs")
+			opts.pairsPerIteration = std::stoi(value);
+		else if (opt == "--nodes")
+			opts.nodes = std::stoull(value);
+		else if (opt == "--rate")
+			opts.rate = std::stod(value);
+		else if (opt == "--openings")
+			opts.openingsPath = value;
+		else if (opt == "--threads")
+			opts.threads = std::stoi(value);
+		else {
+			std::cerr << usage;
+			return 1;
+		}
+	}
+	return runSpsa(opts);
+}
 
-		json req;
-		try {
-			req = json::parse(line);
-		} catch (...) {
-			std::cout << json{{"event", "error"}, {"message", "invalid json"}}.dump() << "\n";
-			std::cout.flush();
-			continue;
+// Apply "name=value,name=value" engine options
+bool parseEngineOptions(const std::string &spec, EngineConfig &cfg) {
+	std::istringstream ss(spec);
+	for (std::string item; std::getline(ss, item, ',');) {
+		size_t eq = item.find('=');
+		if (eq == std::string::npos ||
+		    !setEngineOption(cfg, item.substr(0, eq), std::stoi(item.substr(eq + 1)))) {
+			std::cerr << "Unknown engine option " << item << "\n";
+			return false;
 		}
+	}
+	return true;
+}
 
-		const std::string cmd = req.value("cmd", "");
-		if (cmd == "new-game") {
-			std::string hc = req.value("human_color", "w");
-			Color human = (hc.size() && (hc[0] == 'b' || hc[0] == 'B')) ? BLACK : WHITE;
-			session.newGame(human);
+int runMatchCommand(int argc, char *argv[]) {
+	const char *usage = "Usage: chess match [--games N] [--nodes N | --tc base+inc] [--threads N] "
+	                    "[--openings file.epd] [--a name=value,...] [--b name=value,...] "
+	                    "[--sprt elo0 elo1]\n";
+
+	MatchOptions opts;
+	// Time-controlled games stop on the clock rather than a fixed depth
+	opts.engineA.maxDepth = opts.engineB.maxDepth = 64;
+	for (int i = 2; i < argc; ++i) {
+		std::string opt = argv[i];
+		int values = opt == "--sprt" ? 2 : 1;
+		if (i + values >= argc) {
+			std::cerr << usage;
+			return 1;
+		}
+		std::string value = argv[i + 1];
+		i += values;
+		if (opt == "--games")
+			opts.games = std::stoi(value);
+		else if (opt == "--nodes")
+			opts.limits.nodes = std::stoull(value);
+		else if (opt == "--tc") {
+			// Seconds, e.g. 10+0.1
+			size_t plus = value.find('+');
+			double inc = plus == std::string::npos ? 0.0 : std::stod(value.substr(plus + 1));
+			opts.limits.timeMs = static_cast<int>(std::stod(value.substr(0, plus)) * 1000);
+			opts.limits.incMs = static_cast<int>(inc * 1000);
+		} else if (opt == "--threads")
+			opts.threads = std::stoi(value);
+		else if (opt == "--openings")
+			opts.openingsPath = value;
+		else if (opt == "--a" || opt == "--b") {
+			if (!parseEngineOptions(value, opt == "--a" ? opts.engineA : opts.engineB))
+				return 1;
+		} else if (opt == "--sprt") {
+			opts.sprt = true;
+			opts.elo0 = std::stod(value);
+			opts.elo1 = std::stod(argv[i]);
+		} else {
+			std::cerr << usage;
+			return 1;
+		}
+	}
+	return runMatch(opts);
+}
 
-			auto out = stateJson(session);
-			std::cout << out.dump() << "\n";
-			std::cout.flush();
-			continue;
+int runDatagenCommand(int argc, char *argv[]) {
+	const char *usage = "Usage: chess datagen <out> [--games N] [--nodes N] [--threads N] "
+	                    "[--random-plies N] [--seed N] [--format records|chain]\n";
+	if (argc < 3) {
+		std::cerr << usage;
+		return 1;
+	}
+
+	DatagenOptions opts;
+	opts.outPath = argv[2];
+	for (int i = 3; i + 1 < argc; i += 2) {
+		std::string opt = argv[i];
+		std::string value = argv[i + 1];
+		if (opt == "--games")
+			opts.games = std::stoi(value);
+		else if (opt == "--nodes")
+			opts.nodes = std::stoull(value);
+		else if (opt == "--threads")
+			opts.threads = std::stoi(value);
+		else if (opt == "--random-plies")
+			opts.randomPlies = std::stoi(value);
+		else if (opt == "--seed")
+			opts.seed = static_cast<unsigned>(std::stoul(value));
+		else if (opt == "--format" && (value == "records" || value == "chain"))
+			opts.chain = value == "chain";
+		else {
+			std::cerr << usage;
+			return 1;
 		}
+	}
+	return runDatagen(opts);
+}
 
-		if (cmd == "move") {
-			std::string mv = req.value("move", "");
-			Move hm{};
-			std::string err;
-			if (!session.applyHumanMove(mv, hm, err)) {
-				std::cout << json{{"event", "error"}, {"message", err}}.dump() << "\n";
-				std::cout.flush();
-				continue;
-			}
+int runAnalyzeCommand(int argc, char *argv[]) {
+	const char *usage = "Usage: chess analyze --batch [file.epd] [--depth N] [--nodes N] "
+	                    "[--time ms] [--multipv N] [--threads N] [--hash MB]\n";
+	if (argc < 3 || std::string(argv[2]) != "--batch") {
+		std::cerr << usage;
+		return 1;
+	}
 
-			// If human move ended game, report state immediately.
-			if (session.getGameResult() != GameResult::ONGOING) {
-				std::cout << stateJson(session).dump() << "\n";
-				std::cout.flush();
-				continue;
-			}
+	BatchAnalysisOptions opts;
+	int i = 3;
+	if (i < argc && argv[i][0] != '-')
+		opts.inputPath = argv[i++];
+	for (; i + 1 < argc; i += 2) {
+		std::string opt = argv[i];
+		std::string value = argv[i + 1];
+		if (opt == "--depth")
+			opts.depth = std::stoi(value);
+		else if (opt == "--nodes")
+			opts.nodes = std::stoull(value);
+		else if (opt == "--time")
+			opts.timeMs = std::stoi(value);
+		else if (opt == "--multipv")
+			opts.multiPV = std::stoi(value);
+		else if (opt == "--threads")
+			opts.threads = std::stoi(value);
+		else if (opt == "--hash")
+			opts.hashMb = std::stoi(value);
+		else {
+			std::cerr << usage;
+			return 1;
+		}
+	}
+	if (i != argc) {
+		std::cerr << usage;
+		return 1;
+	}
+	return runBatchAnalysis(opts);
+}
 
-			Move em{};
-			if (!session.applyEngineMove(em)) {
-				std::cout << json{{"event", "error"}, {"message", "engine failed to move"}}.dump()
-				          << "\n";
-				std::cout.flush();
-				continue;
-			}
+int runEvalCommand(int argc, char *argv[]) {
+	const char *usage = "Usage: chess eval --batch [file.epd] [--out file] [--qsearch] "
+	                    "[--binary] [--terms] [--threads N]\n";
+	if (argc < 3 || std::string(argv[2]) != "--batch") {
+		std::cerr << usage;
+		return 1;
+	}
 
-			auto out = stateJson(session);
-			out["engine_move"] = MoveToString(em);
-			std::cout << out.dump() << "\n";
-			std::cout.flush();
-			continue;
+	BatchEvalOptions opts;
+	int i = 3;
+	if (i < argc && argv[i][0] != '-')
+		opts.inputPath = argv[i++];
+	for (; i < argc; ++i) {
+		std::string opt = argv[i];
+		if (opt == "--qsearch")
+			opts.quiescence = true;
+		else if (opt == "--binary")
+			opts.binary = true;
+		else if (opt == "--terms")
+			opts.terms = true;
+		else if (opt == "--out" && i + 1 < argc)
+			opts.outputPath = argv[++i];
+		else if (opt == "--threads" && i + 1 < argc)
+			opts.threads = std::stoi(argv[++i]);
+		else {
+			std::cerr << usage;
+			return 1;
 		}
+	}
+	return runBatchEval(opts);
+}
 
-		std::cout << json{{"event", "error"}, {"message", "unknown cmd"}}.dump() << "\n";
-		std::cout.flush();
+int runProtocolCommand(int argc, char *argv[]) {
+	const char *usage = "Usage: chess --protocol [--hash MB] [--shared-hash name]\n";
+	EngineConfig cfg;
+	for (int i = 2; i + 1 < argc; i += 2) {
+		std::string opt = argv[i];
+		std::string value = argv[i + 1];
+		if (opt == "--hash")
+			cfg.hashMb = std::stoi(value);
+		else if (opt == "--shared-hash")
+			cfg.sharedHash = value;
+		else {
+			std::cerr << usage;
+			return 1;
+		}
+	}
+	if (argc % 2 != 0) {
+		std::cerr << usage;
+		return 1;
 	}
+	return runProtocol(cfg);
+}
 
-	return 0;
+int runServerCommand(int argc, char *argv[]) {
+	const char *usage = "Usage: chess --server [--socket path] [--threads N] [--hash MB] "
+	                    "[--memory MB] [--idle seconds] [--result-cache MB] "
+	                    "[--shared-hash name]\n";
+	ServerOptions opts;
+	for (int i = 2; i + 1 < argc; i += 2) {
+		std::string opt = argv[i];
+		std::string value = argv[i + 1];
+		if (opt == "--socket")
+			opts.socketPath = value;
+		else if (opt == "--threads")
+			opts.threads = std::stoi(value);
+		else if (opt == "--hash")
+			opts.config.hashMb = std::stoi(value);
+		else if (opt == "--memory")
+			opts.memoryLimitMb = std::stoul(value);
+		else if (opt == "--idle")
+			opts.idleSeconds = std::stoi(value);
+		else if (opt == "--result-cache")
+			opts.resultCacheMb = std::stoul(value);
+		else if (opt == "--shared-hash")
+			opts.config.sharedHash = value;
+		else {
+			std::cerr << usage;
+			return 1;
+		}
+	}
+	if (argc % 2 != 0) {
+		std::cerr << usage;
+		return 1;
+	}
+	return runServer(opts);
 }
 
 int main(int argc, char *argv[]) {
+	// Global options, accepted before the mode argument
+	while (argc > 2) {
+		std::string opt = argv[1];
+		std::string error;
+		if (opt == "--eval-file") {
+			if (!Nnue::loadNetwork(argv[2], &error)) {
+				std::cerr << "Failed to load network " << argv[2] << ": " << error << "\n";
+				return 1;
+			}
+		} else if (opt == "--eval-params") {
+			if (!loadEvalParams(argv[2], &error)) {
+				std::cerr << "Failed to load parameters " << argv[2] << ": " << error << "\n";
+				return 1;
+			}
+		} else {
+			break;
+		}
+		argc -= 2;
+		argv += 2;
+	}
+
 	if (argc > 1) {
 		std::string arg1 = argv[1];
 
 		if (arg1 == "--run-tests") {
+			run_packed_position_tests();
+			run_pawn_tests();
+			run_game_chain_tests();
+			run_draw_tests();
+			run_framing_tests();
+			run_server_tests();
+			run_result_cache_tests();
+			run_shared_tt_tests();
 			run_perft_tests();
 			return 0;
 		}
@@ -218,8 +530,69 @@ int main(int argc, char *argv[]) {
 			return runPerft(depth);
 		}
 
+		if (arg1 == "--bench") {
+			int depth = (argc >= 3) ? std::stoi(argv[2]) : 6;
+			return runBench(depth);
+		}
+
 		if (arg1 == "--protocol") {
-			return runProtocol();
+			return runProtocolCommand(argc, argv);
+		}
+
+		if (arg1 == "--uci") {
+			return runUci();
+		}
+
+		if (arg1 == "--server") {
+			return runServerCommand(argc, argv);
+		}
+
+		if (arg1 == "protocol-bench") {
+			return runFramingBench(argc >= 3 ? std::stoi(argv[2]) : 100000);
+		}
+
+		if (arg1 == "train") {
+			return runTrainCommand(argc, argv);
+		}
+
+		if (arg1 == "tune") {
+			return runTuneCommand(argc, argv);
+		}
+
+		if (arg1 == "spsa") {
+			return runSpsaCommand(argc, argv);
+		}
+
+		if (arg1 == "match") {
+			return runMatchCommand(argc, argv);
+		}
+
+		if (arg1 == "datagen") {
+			return runDatagenCommand(argc, argv);
+		}
+
+		if (arg1 == "analyze") {
+			return runAnalyzeCommand(argc, argv);
+		}
+
+		if (arg1 == "eval") {
+			return runEvalCommand(argc, argv);
+		}
+
+		if (arg1 == "epd-scan") {
+			if (argc < 3) {
+				std::cerr << "Usage: chess epd-scan <file.epd> [threads]\n";
+				return 1;
+			}
+			return runEpdScan(argv[2], argc >= 4 ? std::stoi(argv[3]) : 0);
+		}
+
+		if (arg1 == "chain-info") {
+			if (argc < 3) {
+				std::cerr << "Usage: chess chain-info <file.chain>\n";
+				return 1;
+			}
+			return runChainInfo(argv[2]);
 		}
 	}
 
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. Move-only; unmapped on destruction.
+class MappedFile {
+  public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	MappedFile(MappedFile &&other) noexcept;
+	MappedFile &operator=(MappedFile &&other) noexcept;
+
+	bool open(const std::string &path);
+	void close();
+
+	bool isOpen() const { return base != nullptr; }
+	const char *data() const { return static_cast<const char *>(base); }
+	size_t size() const { return length; }
+
+  private:
+	void *base = nullptr;
+	size_t length = 0;
+};
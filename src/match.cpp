@@ -0,0 +1,135 @@
+#include "match.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr int RANDOM_OPENING_PLIES = 8;
+
+// Expected score for an Elo difference and back
+double scoreFromElo(double elo) { return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0)); }
+
+double eloFromScore(double score) {
+	score = std::clamp(score, 1e-3, 1.0 - 1e-3);
+	return 400.0 * std::log10(score / (1.0 - score));
+}
+
+// Per-game variance of A's score
+double scoreVariance(const MatchScore &m) {
+	const int n = m.games();
+	if (n == 0)
+		return 0.0;
+	const double s = m.score();
+	return (m.wins * (1.0 - s) * (1.0 - s) + m.draws * (0.5 - s) * (0.5 - s) + m.losses * s * s) /
+	       n;
+}
+
+} // namespace
+
+double MatchScore::score() const {
+	return games() ? (wins + 0.5 * draws) / games() : 0.5;
+}
+
+double MatchScore::elo() const { return eloFromScore(score()); }
+
+double MatchScore::eloError() const {
+	if (games() == 0)
+		return 0.0;
+	const double margin = 1.959964 * std::sqrt(scoreVariance(*this) / games());
+	return (eloFromScore(score() + margin) - eloFromScore(score() - margin)) / 2.0;
+}
+
+double MatchScore::llr(double elo0, double elo1) const {
+	const double variance = scoreVariance(*this);
+	if (variance <= 0.0)
+		return 0.0;
+	const double s0 = scoreFromElo(elo0), s1 = scoreFromElo(elo1);
+	return games() * (s1 - s0) * (2.0 * score() - s0 - s1) / (2.0 * variance);
+}
+
+int runMatch(const MatchOptions &opts) {
+	std::vector<std::string> openings;
+	if (!opts.openingsPath.empty()) {
+		openings = loadOpenings(opts.openingsPath);
+		if (openings.empty()) {
+			std::cerr << "No usable openings in " << opts.openingsPath << "\n";
+			return 1;
+		}
+	}
+
+	const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+	const int threads = opts.threads > 0 ? opts.threads : std::max(1, hardware);
+	const int pairs = (std::max(1, opts.games) + 1) / 2;
+
+	// Openings are picked up front so the schedule does not depend on thread timing
+	std::vector<Position> starts(pairs);
+	std::mt19937_64 rng(1);
+	for (int p = 0; p < pairs; ++p) {
+		if (openings.empty())
+			starts[p] = randomOpening(rng, RANDOM_OPENING_PLIES);
+		else
+			starts[p].setFromFEN(openings[p % openings.size()]);
+	}
+
+	const double lower = std::log(opts.beta / (1.0 - opts.alpha));
+	const double upper = std::log((1.0 - opts.beta) / opts.alpha);
+
+	std::printf("Match: %d games, %d threads, ", 2 * pairs, threads);
+	if (opts.limits.nodes > 0)
+		std::printf("%llu nodes per move", static_cast<unsigned long long>(opts.limits.nodes));
+	else
+		std::printf("%d+%dms", opts.limits.timeMs, opts.limits.incMs);
+	if (opts.sprt)
+		std::printf(", SPRT elo0 %.1f elo1 %.1f bounds [%.2f, %.2f]", opts.elo0, opts.elo1, lower,
+		            upper);
+	std::printf("\n");
+
+	MatchScore total;
+	std::mutex mutex;
+	std::atomic<bool> stop{false};
+	const char *verdict = nullptr;
+
+	parallelFor(threads, 2 * pairs, [&](size_t g) {
+		if (stop)
+			return;
+		const bool aWhite = g % 2 == 0;
+		GameOutcome outcome = playGame(starts[g / 2], aWhite ? opts.engineA : opts.engineB,
+		                               aWhite ? opts.engineB : opts.engineA, opts.limits);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (outcome == GameOutcome::DRAW)
+			++total.draws;
+		else if ((outcome == GameOutcome::WHITE_WIN) == aWhite)
+			++total.wins;
+		else
+			++total.losses;
+
+		std::printf("Games %5d  +%d -%d =%d  score %.3f  elo %7.1f +/- %.1f", total.games(),
+		            total.wins, total.losses, total.draws, total.score(), total.elo(),
+		            total.eloError());
+		if (opts.sprt) {
+			double llr = total.llr(opts.elo0, opts.elo1);
+			std::printf("  llr %.2f", llr);
+			if (!verdict && llr >= upper)
+				verdict = "H1 accepted";
+			else if (!verdict && llr <= lower)
+				verdict = "H0 accepted";
+			if (verdict)
+				stop = true;
+		}
+		std::printf("\n");
+		std::fflush(stdout);
+	});
+
+	std::printf("Final: +%d -%d =%d  elo %.1f +/- %.1f", total.wins, total.losses, total.draws,
+	            total.elo(), total.eloError());
+	if (opts.sprt)
+		std::printf("  SPRT: %s", verdict ? verdict : "inconclusive");
+	std::printf("\n");
+	return 0;
+}
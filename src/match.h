@@ -0,0 +1,39 @@
+#pragma once
+#include "engine_session.h"
+#include "selfplay.h"
+#include <string>
+
+struct MatchOptions {
+	EngineConfig engineA;
+	EngineConfig engineB;
+	std::string openingsPath; // EPD/FEN suite, random openings when empty
+	int games = 100;          // rounded up to whole pairs; each opening is played with both colours
+	int threads = 0;          // 0 uses every hardware thread
+	GameLimits limits;
+
+	// Stop as soon as the sequential probability ratio test accepts H0 (elo <= elo0) or
+	// H1 (elo >= elo1) at the given error rates
+	bool sprt = false;
+	double elo0 = 0.0;
+	double elo1 = 5.0;
+	double alpha = 0.05;
+	double beta = 0.05;
+};
+
+// Results of A against B
+struct MatchScore {
+	int wins = 0;
+	int losses = 0;
+	int draws = 0;
+
+	int games() const { return wins + losses + draws; }
+	double score() const; // A's points per game
+	double elo() const;
+	double eloError() const; // 95% confidence half-width
+	// Log-likelihood ratio of H1 (elo1) against H0 (elo0), from the normal approximation
+	double llr(double elo0, double elo1) const;
+};
+
+// Play A against B on a pool of threads and print the running score, Elo with error bars and
+// the SPRT state after every game. Returns a process exit code.
+int runMatch(const MatchOptions &opts);
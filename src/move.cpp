@@ -4,3 +4,28 @@
 std::string MoveToString(const Move &m) {
 	return std::to_string(m.from) + "->" + std::to_string(m.to);
 }
+
+std::string MoveToUci(const Move &m) {
+	std::string s;
+	s += char('a' + (m.from & 7));
+	s += char('1' + (m.from >> 4));
+	s += char('a' + (m.to & 7));
+	s += char('1' + (m.to >> 4));
+	if (m.flags & MF_PROMOTION) {
+		switch (pieceType(m.promotion)) {
+		case WN:
+			s += 'n';
+			break;
+		case WB:
+			s += 'b';
+			break;
+		case WR:
+			s += 'r';
+			break;
+		default:
+			s += 'q';
+			break;
+		}
+	}
+	return s;
+}
@@ -27,3 +27,6 @@ inline Move make_move(int from, int to, int piece, int captured = EMPTY, int pro
 }
 
 std::string MoveToString(const Move &m);
+
+// Long algebraic form used by UCI, e.g. "e2e4" or "e7e8q"
+std::string MoveToUci(const Move &m);
@@ -0,0 +1,460 @@
+#include "nnue.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NNUE_X86 1
+#endif
+
+namespace Nnue {
+
+namespace {
+
+// ---------------------------------------------------------------------------------------------
+// Kernels
+
+struct Kernels {
+	const char *name;
+	void (*addRow)(int16_t *acc, const int16_t *row);
+	void (*subRow)(int16_t *acc, const int16_t *row);
+	// Clip L1 accumulator values into [0, ACT_MAX]
+	void (*clip)(const int16_t *in, uint8_t *out);
+	// out[o] = bias[o] + sum_i in[i] * weights[o][i] for the 2 * L1 -> L2 layer
+	void (*affine)(const uint8_t *in, const int8_t *weights, const int32_t *bias, int32_t *out);
+};
+
+void addRowScalar(int16_t *acc, const int16_t *row) {
+	for (int i = 0; i < L1; ++i)
+		acc[i] += row[i];
+}
+
+void subRowScalar(int16_t *acc, const int16_t *row) {
+	for (int i = 0; i < L1; ++i)
+		acc[i] -= row[i];
+}
+
+void clipScalar(const int16_t *in, uint8_t *out) {
+	for (int i = 0; i < L1; ++i)
+		out[i] = static_cast<uint8_t>(std::clamp<int>(in[i], 0, ACT_MAX));
+}
+
+void affineScalar(const uint8_t *in, const int8_t *weights, const int32_t *bias, int32_t *out) {
+	for (int o = 0; o < L2; ++o) {
+		const int8_t *row = weights + o * 2 * L1;
+		int32_t sum = bias[o];
+		for (int i = 0; i < 2 * L1; ++i)
+			sum += in[i] * row[i];
+		out[o] = sum;
+	}
+}
+
+#ifdef NNUE_X86
+
+__attribute__((target("sse4.1"))) void addRowSse(int16_t *acc, const int16_t *row) {
+	for (int i = 0; i < L1; i += 8) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+		__m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), _mm_add_epi16(a, w));
+	}
+}
+
+__attribute__((target("sse4.1"))) void subRowSse(int16_t *acc, const int16_t *row) {
+	for (int i = 0; i < L1; i += 8) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+		__m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), _mm_sub_epi16(a, w));
+	}
+}
+
+__attribute__((target("sse4.1"))) void clipSse(const int16_t *in, uint8_t *out) {
+	const __m128i zero = _mm_setzero_si128();
+	for (int i = 0; i < L1; i += 16) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 8));
+		__m128i packed = _mm_max_epi8(_mm_packs_epi16(a, b), zero);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+	}
+}
+
+__attribute__((target("sse4.1"))) void affineSse(const uint8_t *in, const int8_t *weights,
+                                                 const int32_t *bias, int32_t *out) {
+	const __m128i ones = _mm_set1_epi16(1);
+	for (int o = 0; o < L2; ++o) {
+		const int8_t *row = weights + o * 2 * L1;
+		__m128i sum = _mm_setzero_si128();
+		for (int i = 0; i < 2 * L1; i += 16) {
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+			__m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+		}
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+		out[o] = bias[o] + _mm_cvtsi128_si32(sum);
+	}
+}
+
+__attribute__((target("avx2"))) void addRowAvx2(int16_t *acc, const int16_t *row) {
+	for (int i = 0; i < L1; i += 16) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + i));
+		__m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + i), _mm256_add_epi16(a, w));
+	}
+}
+
+__attribute__((target("avx2"))) void subRowAvx2(int16_t *acc, const int16_t *row) {
+	for (int i = 0; i < L1; i += 16) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + i));
+		__m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + i), _mm256_sub_epi16(a, w));
+	}
+}
+
+__attribute__((target("avx2"))) void clipAvx2(const int16_t *in, uint8_t *out) {
+	const __m256i zero = _mm256_setzero_si256();
+	for (int i = 0; i < L1; i += 32) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i + 16));
+		// packs works per 128-bit lane; restore element order afterwards
+		__m256i packed = _mm256_max_epi8(_mm256_packs_epi16(a, b), zero);
+		packed = _mm256_permute4x64_epi64(packed, 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+	}
+}
+
+__attribute__((target("avx2"))) void affineAvx2(const uint8_t *in, const int8_t *weights,
+                                                const int32_t *bias, int32_t *out) {
+	const __m256i ones = _mm256_set1_epi16(1);
+	for (int o = 0; o < L2; ++o) {
+		const int8_t *row = weights + o * 2 * L1;
+		__m256i sum = _mm256_setzero_si256();
+		for (int i = 0; i < 2 * L1; i += 32) {
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+			__m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+			sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+		}
+		__m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+		s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+		s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+		out[o] = bias[o] + _mm_cvtsi128_si32(s);
+	}
+}
+
+#endif // NNUE_X86
+
+const Kernels ScalarKernels = {"scalar", addRowScalar, subRowScalar, clipScalar, affineScalar};
+#ifdef NNUE_X86
+const Kernels SseKernels = {"sse4.1", addRowSse, subRowSse, clipSse, affineSse};
+const Kernels Avx2Kernels = {"avx2", addRowAvx2, subRowAvx2, clipAvx2, affineAvx2};
+#endif
+
+const Kernels *detectKernels() {
+#ifdef NNUE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return &Avx2Kernels;
+	if (__builtin_cpu_supports("sse4.1"))
+		return &SseKernels;
+#endif
+	return &ScalarKernels;
+}
+
+const Kernels *kernels = detectKernels();
+
+// ---------------------------------------------------------------------------------------------
+// Network
+
+struct Network {
+	MappedFile file;
+	std::string path;
+	const int16_t *ftWeights = nullptr;
+	const int16_t *ftBias = nullptr;
+	const int8_t *l1Weights = nullptr;
+	const int32_t *l1Bias = nullptr;
+	const int8_t *outWeights = nullptr;
+	const int32_t *outBias = nullptr;
+};
+
+std::unique_ptr<Network> network;
+
+// ---------------------------------------------------------------------------------------------
+// Accumulators
+
+// How far back to look for an ancestor accumulator before rebuilding instead
+constexpr size_t MAX_INCREMENTAL_PLIES = 16;
+
+struct alignas(64) Accumulator {
+	int16_t values[2][L1];
+	u64 key = 0;
+	bool computed[2] = {false, false};
+	int bucket[2] = {0, 0};
+};
+
+// One accumulator per ply of Position::stateStack, owned by the calling thread
+std::vector<Accumulator> &threadAccumulators() {
+	thread_local std::vector<Accumulator> stack;
+	return stack;
+}
+
+inline int toSq64(int sq) { return ((sq >> 4) << 3) | (sq & 7); }
+
+// King bucket from persp's own view: 4 rank bands x 2 board halves
+inline int kingBucket(Color persp, int kingSq) {
+	int s = toSq64(kingSq);
+	if (persp == BLACK)
+		s ^= 56;
+	int rank = s >> 3;
+	int band = rank == 0 ? 0 : rank == 1 ? 1 : rank < 4 ? 2 : 3;
+	return band * 2 + ((s & 7) >= 4 ? 1 : 0);
+}
+
+inline int bucketFeature(Color persp, int bucket, int piece, int sq) {
+	int s = toSq64(sq);
+	if (persp == BLACK)
+		s ^= 56;
+	int rel = (pieceColor(piece) == persp ? 0 : 6) + pieceType(piece) - WP;
+	return (bucket * 12 + rel) * 64 + s;
+}
+
+int findKing(const Position &pos, Color c) {
+	const int king = (c == WHITE) ? WK : BK;
+	for (int sq = 0; sq < 128; ++sq) {
+		if (sq & 0x88) {
+			sq += 7;
+			continue;
+		}
+		if (pos.board[sq] == king)
+			return sq;
+	}
+	return Position::makeSquare(4, c == WHITE ? 0 : 7);
+}
+
+void refresh(const Position &pos, Color persp, Accumulator &acc) {
+	const Network &net = *network;
+	int bucket = kingBucket(persp, findKing(pos, persp));
+	int16_t *values = acc.values[persp];
+
+	std::memcpy(values, net.ftBias, sizeof(int16_t) * L1);
+	for (int sq = 0; sq < 128; ++sq) {
+		if (sq & 0x88) {
+			sq += 7;
+			continue;
+		}
+		int p = pos.board[sq];
+		if (p != EMPTY)
+			kernels->addRow(values, net.ftWeights + bucketFeature(persp, bucket, p, sq) * L1);
+	}
+	acc.bucket[persp] = bucket;
+	acc.computed[persp] = true;
+	++threadStats().refreshes;
+}
+
+// True if the move described by d takes persp's king into another bucket
+bool kingChangesBucket(const DirtyPieces &d, Color persp) {
+	const int king = (persp == WHITE) ? WK : BK;
+	for (int i = 0; i < d.count; ++i)
+		if (d.piece[i] == king && kingBucket(persp, d.from[i]) != kingBucket(persp, d.to[i]))
+			return true;
+	return false;
+}
+
+// Derive dst from src by playing (forward) or taking back the move described by d
+void applyMove(const Accumulator &src, Accumulator &dst, const DirtyPieces &d, Color persp,
+               bool forward) {
+	const Network &net = *network;
+	const int bucket = src.bucket[persp];
+	int16_t *values = dst.values[persp];
+	std::memcpy(values, src.values[persp], sizeof(int16_t) * L1);
+
+	for (int k = 0; k < d.count; ++k) {
+		int removed = forward ? d.from[k] : d.to[k];
+		int added = forward ? d.to[k] : d.from[k];
+		if (removed >= 0)
+			kernels->subRow(values,
+			                net.ftWeights + bucketFeature(persp, bucket, d.piece[k], removed) * L1);
+		if (added >= 0)
+			kernels->addRow(values,
+			                net.ftWeights + bucketFeature(persp, bucket, d.piece[k], added) * L1);
+	}
+	dst.bucket[persp] = bucket;
+	dst.computed[persp] = true;
+}
+
+// Point entry at the position with the given key, dropping results for any other position
+void claim(Accumulator &entry, u64 key) {
+	if (entry.key != key) {
+		entry.key = key;
+		entry.computed[WHITE] = entry.computed[BLACK] = false;
+	}
+}
+
+void update(const Position &pos, Color persp, std::vector<Accumulator> &stack) {
+	const size_t ply = pos.stateStack.size();
+	if (stack[ply].computed[persp])
+		return;
+
+	auto keyAt = [&](size_t i) { return i == ply ? pos.key : pos.stateStack[i].key; };
+
+	// Walk back to the nearest ancestor whose accumulator still matches this game line
+	size_t q = ply;
+	bool found = false;
+	while (q > 0 && ply - q < MAX_INCREMENTAL_PLIES) {
+		if (kingChangesBucket(pos.stateStack[q - 1].dirty, persp))
+			break;
+		--q;
+		const Accumulator &a = stack[q];
+		if (a.computed[persp] && a.key == keyAt(q)) {
+			found = true;
+			break;
+		}
+	}
+
+	if (found) {
+		// Play the moves forward, filling every ply so siblings can start from their parent
+		for (size_t i = q; i < ply; ++i) {
+			claim(stack[i + 1], keyAt(i + 1));
+			applyMove(stack[i], stack[i + 1], pos.stateStack[i].dirty, persp, true);
+		}
+		++threadStats().incremental;
+		return;
+	}
+
+	refresh(pos, persp, stack[ply]);
+
+	// Take the moves back into the ancestors so the rest of this subtree stays incremental
+	for (size_t i = ply; i > 0 && ply - i < MAX_INCREMENTAL_PLIES; --i) {
+		const DirtyPieces &d = pos.stateStack[i - 1].dirty;
+		Accumulator &parent = stack[i - 1];
+		if (kingChangesBucket(d, persp) ||
+		    (parent.computed[persp] && parent.key == keyAt(i - 1)))
+			break;
+		claim(parent, keyAt(i - 1));
+		applyMove(stack[i], parent, d, persp, false);
+	}
+}
+
+} // namespace
+
+FileLayout fileLayout() {
+	auto align = [](size_t n) { return (n + 63) & ~static_cast<size_t>(63); };
+	FileLayout l{};
+	size_t off = sizeof(FileHeader);
+	l.ftWeights = off;
+	off = align(off + sizeof(int16_t) * INPUTS * L1);
+	l.ftBias = off;
+	off = align(off + sizeof(int16_t) * L1);
+	l.l1Weights = off;
+	off = align(off + sizeof(int8_t) * L2 * 2 * L1);
+	l.l1Bias = off;
+	off = align(off + sizeof(int32_t) * L2);
+	l.outWeights = off;
+	off = align(off + sizeof(int8_t) * L2);
+	l.outBias = off;
+	off = align(off + sizeof(int32_t));
+	l.total = off;
+	return l;
+}
+
+int featureIndex(Color persp, int kingSq, int piece, int sq) {
+	return bucketFeature(persp, kingBucket(persp, kingSq), piece, sq);
+}
+
+bool loadNetwork(const std::string &path, std::string *error) {
+	auto fail = [&](const char *msg) {
+		if (error)
+			*error = msg;
+		return false;
+	};
+
+	auto net = std::make_unique<Network>();
+	if (!net->file.open(path))
+		return fail("cannot open network file");
+
+	const FileLayout layout = fileLayout();
+	if (net->file.size() < layout.total)
+		return fail("network file too small");
+
+	FileHeader header;
+	std::memcpy(&header, net->file.data(), sizeof(header));
+	if (header.magic != FILE_MAGIC || header.version != FILE_VERSION)
+		return fail("not a network file or unsupported version");
+	if (header.inputs != INPUTS || header.l1 != L1 || header.l2 != L2)
+		return fail("network dimensions do not match this build");
+
+	const char *base = net->file.data();
+	net->path = path;
+	net->ftWeights = reinterpret_cast<const int16_t *>(base + layout.ftWeights);
+	net->ftBias = reinterpret_cast<const int16_t *>(base + layout.ftBias);
+	net->l1Weights = reinterpret_cast<const int8_t *>(base + layout.l1Weights);
+	net->l1Bias = reinterpret_cast<const int32_t *>(base + layout.l1Bias);
+	net->outWeights = reinterpret_cast<const int8_t *>(base + layout.outWeights);
+	net->outBias = reinterpret_cast<const int32_t *>(base + layout.outBias);
+
+	network = std::move(net);
+	return true;
+}
+
+bool isLoaded() { return network != nullptr; }
+
+const std::string &loadedPath() {
+	static const std::string none;
+	return network ? network->path : none;
+}
+
+int evaluate(const Position &pos) {
+	const Network &net = *network;
+	++threadStats().evals;
+
+	std::vector<Accumulator> &stack = threadAccumulators();
+	const size_t ply = pos.stateStack.size();
+	if (stack.size() <= ply)
+		stack.resize(ply + 64);
+
+	Accumulator &top = stack[ply];
+	claim(top, pos.key);
+	update(pos, WHITE, stack);
+	update(pos, BLACK, stack);
+
+	alignas(64) uint8_t input[2 * L1];
+	kernels->clip(top.values[pos.sideToMove], input);
+	kernels->clip(top.values[opposite(pos.sideToMove)], input + L1);
+
+	alignas(64) int32_t hidden[L2];
+	kernels->affine(input, net.l1Weights, net.l1Bias, hidden);
+
+	int64_t out = *net.outBias;
+	for (int o = 0; o < L2; ++o)
+		out += std::clamp(hidden[o] / WEIGHT_SCALE, 0, ACT_MAX) * net.outWeights[o];
+
+	return static_cast<int>(out * OUTPUT_SCALE / (ACT_MAX * WEIGHT_SCALE));
+}
+
+const char *kernelName() { return kernels->name; }
+
+bool selectKernel(const std::string &name) {
+	if (name == ScalarKernels.name) {
+		kernels = &ScalarKernels;
+		return true;
+	}
+#ifdef NNUE_X86
+	if (name == SseKernels.name && __builtin_cpu_supports("sse4.1")) {
+		kernels = &SseKernels;
+		return true;
+	}
+	if (name == Avx2Kernels.name && __builtin_cpu_supports("avx2")) {
+		kernels = &Avx2Kernels;
+		return true;
+	}
+#endif
+	return false;
+}
+
+Stats &threadStats() {
+	thread_local Stats stats;
+	return stats;
+}
+
+} // namespace Nnue
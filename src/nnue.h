@@ -0,0 +1,75 @@
+#pragma once
+#include "position.h"
+#include <cstdint>
+#include <string>
+
+// Efficiently updatable neural network evaluation.
+//
+// Inputs are HalfKA-style features seen from each side: (king bucket, piece, square) with the
+// board flipped for Black. Each side keeps a first-layer accumulator that is updated from the
+// DirtyPieces of every move and only rebuilt from scratch when its own king changes bucket.
+// Layers are quantized: int16 feature transformer, int8 hidden and output layers.
+namespace Nnue {
+
+static constexpr int KING_BUCKETS = 8;
+static constexpr int INPUTS = KING_BUCKETS * 12 * 64;
+static constexpr int L1 = 128; // accumulator width per side
+static constexpr int L2 = 32;  // hidden layer width
+
+// Quantization: activations are clipped to [0, ACT_MAX], hidden and output weights are scaled
+// by WEIGHT_SCALE, and the output is converted to centipawns with OUTPUT_SCALE.
+static constexpr int ACT_MAX = 127;
+static constexpr int WEIGHT_SCALE = 64;
+static constexpr int OUTPUT_SCALE = 400;
+
+static constexpr uint32_t FILE_MAGIC = 0x4E4E5743; // "CWNN" little-endian
+static constexpr uint32_t FILE_VERSION = 1;
+
+// On-disk layout: a 64-byte header, then each array in this order, each starting on a 64-byte
+// boundary. All values are little-endian.
+struct FileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t inputs;
+	uint32_t l1;
+	uint32_t l2;
+	uint32_t reserved[11];
+};
+static_assert(sizeof(FileHeader) == 64, "header must stay 64 bytes");
+
+struct FileLayout {
+	size_t ftWeights;  // int16[INPUTS][L1]
+	size_t ftBias;     // int16[L1]
+	size_t l1Weights;  // int8[L2][2 * L1], side to move first
+	size_t l1Bias;     // int32[L2]
+	size_t outWeights; // int8[L2]
+	size_t outBias;    // int32
+	size_t total;
+};
+FileLayout fileLayout();
+
+// Feature index for piece on sq (0x88) seen from persp, whose king is on kingSq (0x88)
+int featureIndex(Color persp, int kingSq, int piece, int sq);
+
+// Map a network file; returns false and keeps the previous network on failure
+bool loadNetwork(const std::string &path, std::string *error = nullptr);
+bool isLoaded();
+const std::string &loadedPath();
+
+// Evaluation from the side to move's point of view, in centipawns
+int evaluate(const Position &pos);
+
+// SIMD kernel set in use ("avx2", "sse4.1" or "scalar"), picked at startup from the CPU
+const char *kernelName();
+// Force a kernel set by name; returns false if unknown or unsupported on this CPU
+bool selectKernel(const std::string &name);
+
+// Per-thread accumulator counters
+struct Stats {
+	u64 evals = 0;
+	u64 incremental = 0; // accumulator updates applied from dirty pieces
+	u64 refreshes = 0;   // accumulator rebuilds from the board
+};
+Stats &threadStats();
+
+} // namespace Nnue
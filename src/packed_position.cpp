@@ -0,0 +1,52 @@
+#include "packed_position.h"
+#include <algorithm>
+
+PackedPosition packPosition(const Position &pos) {
+	PackedPosition packed{};
+	u64 occupied = 0;
+	int n = 0;
+	for (int sq64 = 0; sq64 < 64; ++sq64) {
+		const int p = pos.board[((sq64 >> 3) << 4) | (sq64 & 7)];
+		occupied |= static_cast<u64>(p != EMPTY) << sq64;
+		// Empty squares OR in zero at the next slot, so only occupied squares advance n
+		packed.pieces[(n >> 1) & 15] |= static_cast<uint8_t>(p << ((n & 1) * 4));
+		n += p != EMPTY;
+	}
+	std::memcpy(packed.occupancy, &occupied, sizeof(occupied));
+	packed.flags = static_cast<uint8_t>(pos.sideToMove | (pos.castlingRights & 0xF) << 1);
+	packed.epSquare = pos.epSquare < 0
+	                      ? PackedPosition::NO_EP_SQUARE
+	                      : static_cast<uint8_t>(((pos.epSquare >> 4) << 3) | (pos.epSquare & 7));
+	packed.halfmoveClock = static_cast<uint8_t>(std::clamp(pos.halfmoveClock, 0, 255));
+	packed.fullmoveNumber = static_cast<uint16_t>(std::clamp(pos.fullmoveNumber, 0, 65535));
+	return packed;
+}
+
+bool unpackPosition(const PackedPosition &packed, Position &pos) {
+	if (packed.pieceCount() > 32 || packed.epSquare > PackedPosition::NO_EP_SQUARE)
+		return false;
+
+	pos.board.fill(EMPTY);
+	pos.stateStack.clear();
+	u64 occupied = packed.occupied();
+	for (int n = 0; occupied; ++n, occupied &= occupied - 1) {
+		const int sq64 = __builtin_ctzll(occupied);
+		const int p = packed.piece(n);
+		if (p == EMPTY || p > BK)
+			return false;
+		pos.board[((sq64 >> 3) << 4) | (sq64 & 7)] = p;
+	}
+	if (!pos.hasValidPieces())
+		return false;
+
+	pos.sideToMove = packed.sideToMove();
+	pos.castlingRights = (packed.flags >> 1) & 0xF;
+	pos.epSquare = packed.epSquare == PackedPosition::NO_EP_SQUARE
+	                   ? -1
+	                   : ((packed.epSquare >> 3) << 4) | (packed.epSquare & 7);
+	pos.halfmoveClock = packed.halfmoveClock;
+	pos.fullmoveNumber = packed.fullmoveNumber;
+	pos.refreshEval();
+	pos.refreshKeys();
+	return true;
+}
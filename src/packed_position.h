@@ -0,0 +1,42 @@
+#pragma once
+#include "position.h"
+#include <cstdint>
+#include <cstring>
+
+// Fixed 32-byte encoding of a Position for datasets and on-disk caches.
+//
+// occupancy is a native-endian bitboard with bit sq64 (a1 = 0, h8 = 63) set for every occupied
+// square, kept as bytes so records embedding it stay unpadded. pieces holds their Piece values
+// one nibble each in ascending square order (first piece = low nibble of byte 0). Legal
+// positions have at most 32 pieces, which is all the nibbles fit. Clocks saturate at their field
+// widths.
+struct PackedPosition {
+	uint8_t occupancy[8];
+	uint8_t pieces[16];
+	uint8_t flags;         // bit 0 side to move, bits 1-4 CastleRights
+	uint8_t epSquare;      // sq64, or NO_EP_SQUARE
+	uint8_t halfmoveClock;
+	uint8_t reserved;
+	uint16_t fullmoveNumber;
+	uint16_t reserved2;
+
+	static constexpr uint8_t NO_EP_SQUARE = 64;
+
+	u64 occupied() const {
+		u64 bits;
+		std::memcpy(&bits, occupancy, sizeof(bits));
+		return bits;
+	}
+	Color sideToMove() const { return static_cast<Color>(flags & 1); }
+	int pieceCount() const { return __builtin_popcountll(occupied()); }
+	// Piece of the index-th occupied square
+	int piece(int index) const { return (pieces[index >> 1] >> ((index & 1) * 4)) & 0xF; }
+};
+static_assert(sizeof(PackedPosition) == 32, "packed positions are stored as raw 32-byte structs");
+
+PackedPosition packPosition(const Position &pos);
+
+// Set pos from a packed position, clearing its undo history. Returns false for encodings no
+// Position packs to (more than 32 pieces, bad piece or square values, pieces that fail
+// Position::hasValidPieces).
+bool unpackPosition(const PackedPosition &packed, Position &pos);
@@ -0,0 +1,142 @@
+#include "pawns.h"
+#include "eval_params.h"
+
+namespace {
+
+inline u64 bit(int file, int rank) { return 1ULL << (rank * 8 + file); }
+
+inline bool hasPawn(const u64 pawns, int file, int rank) {
+	if (file < 0 || file > 7 || rank < 0 || rank > 7)
+		return false;
+	return (pawns & bit(file, rank)) != 0;
+}
+
+// Any pawn of the set on the given file strictly between the two ranks (exclusive bounds)
+inline bool anyOnFileBetween(const u64 pawns, int file, int lowRank, int highRank) {
+	if (file < 0 || file > 7)
+		return false;
+	for (int r = lowRank + 1; r < highRank; ++r)
+		if (pawns & bit(file, r))
+			return true;
+	return false;
+}
+
+} // namespace
+
+PawnHashTable::PawnHashTable(size_t entryCount) : entries(entryCount) {}
+
+const PawnEntry &PawnHashTable::probe(const Position &pos) {
+	++probes;
+	PawnEntry &e = entries[pos.pawnKey & (entries.size() - 1)];
+	if (e.key == pos.pawnKey) {
+		++hits;
+		return e;
+	}
+	evaluatePawns(pos, e);
+	e.key = pos.pawnKey;
+	return e;
+}
+
+PawnHashTable &threadPawnTable() {
+	thread_local PawnHashTable table;
+	return table;
+}
+
+void evaluatePawns(const Position &pos, PawnEntry &entry, EvalTrace *trace) {
+	u64 pawns[2] = {0, 0};
+	for (int rank = 0; rank < 8; ++rank) {
+		for (int file = 0; file < 8; ++file) {
+			int p = pos.board[Position::makeSquare(file, rank)];
+			if (p == WP)
+				pawns[WHITE] |= bit(file, rank);
+			else if (p == BP)
+				pawns[BLACK] |= bit(file, rank);
+		}
+	}
+
+	int mg[2] = {0, 0};
+	int eg[2] = {0, 0};
+	entry.passed[WHITE] = entry.passed[BLACK] = 0;
+
+	for (int c = WHITE; c <= BLACK; ++c) {
+		const u64 ours = pawns[c];
+		const u64 theirs = pawns[c ^ 1];
+		const int up = (c == WHITE) ? 1 : -1;
+		auto add = [&](int term) {
+			mg[c] += paramMg(term);
+			eg[c] += paramEg(term);
+			if (trace)
+				trace->coef[term] += (c == WHITE) ? 1 : -1;
+		};
+
+		for (int rank = 0; rank < 8; ++rank) {
+			for (int file = 0; file < 8; ++file) {
+				if (!(ours & bit(file, rank)))
+					continue;
+
+				const int relRank = (c == WHITE) ? rank : 7 - rank;
+				const int front = (c == WHITE) ? 8 : -1; // one past the last rank ahead
+
+				// Doubled: another own pawn in front on the same file
+				bool doubled = (c == WHITE) ? anyOnFileBetween(ours, file, rank, 8)
+				                            : anyOnFileBetween(ours, file, -1, rank);
+
+				bool isolated = true;
+				for (int r = 0; r < 8; ++r) {
+					if (hasPawn(ours, file - 1, r) || hasPawn(ours, file + 1, r)) {
+						isolated = false;
+						break;
+					}
+				}
+
+				// Passed: no enemy pawn ahead on this or an adjacent file
+				bool passed = true;
+				for (int df = -1; df <= 1 && passed; ++df) {
+					bool blocked = (c == WHITE) ? anyOnFileBetween(theirs, file + df, rank, front)
+					                            : anyOnFileBetween(theirs, file + df, front, rank);
+					if (blocked)
+						passed = false;
+				}
+
+				bool supported =
+				    hasPawn(ours, file - 1, rank - up) || hasPawn(ours, file + 1, rank - up);
+				bool phalanx = hasPawn(ours, file - 1, rank) || hasPawn(ours, file + 1, rank);
+
+				// Backward: no own pawn beside or behind on adjacent files to support its
+				// advance, and the stop square is controlled by an enemy pawn.
+				bool backward = false;
+				if (!isolated && !passed && !supported && !phalanx) {
+					bool canBeSupported = false;
+					for (int r = rank; r >= 0 && r <= 7; r -= up) {
+						if (hasPawn(ours, file - 1, r) || hasPawn(ours, file + 1, r)) {
+							canBeSupported = true;
+							break;
+						}
+					}
+					int stop = rank + up;
+					bool stopAttacked = hasPawn(theirs, file - 1, stop + up) ||
+					                    hasPawn(theirs, file + 1, stop + up);
+					backward = !canBeSupported && stopAttacked;
+				}
+
+				if (doubled)
+					add(TERM_DOUBLED);
+				if (isolated)
+					add(TERM_ISOLATED);
+				if (backward)
+					add(TERM_BACKWARD);
+				if (supported)
+					add(TERM_SUPPORTED);
+				if (phalanx)
+					add(TERM_PHALANX);
+				if (passed && !doubled) {
+					add(TERM_PASSED + relRank);
+					entry.passed[c] |= bit(file, rank);
+				}
+			}
+		}
+	}
+
+	entry.mg = mg[WHITE] - mg[BLACK];
+	entry.eg = eg[WHITE] - eg[BLACK];
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "position.h"
+#include <vector>
+
+// Cached pawn structure evaluation for one pawn configuration. Scores are from White's point
+// of view; passed holds each side's passed pawns as a bit per square (rank * 8 + file).
+struct PawnEntry {
+	u64 key = 0;
+	int mg = 0;
+	int eg = 0;
+	u64 passed[2] = {0, 0};
+};
+
+// Direct-mapped table keyed by Position::pawnKey. Pawn structure changes only on pawn moves
+// and captures of pawns, so most probes are hits and skip the board scan entirely.
+class PawnHashTable {
+  public:
+	explicit PawnHashTable(size_t entryCount = 1 << 14);
+
+	const PawnEntry &probe(const Position &pos);
+
+	u64 probes = 0;
+	u64 hits = 0;
+
+  private:
+	std::vector<PawnEntry> entries;
+};
+
+// Pawn table owned by the calling thread
+PawnHashTable &threadPawnTable();
+
+struct EvalTrace;
+
+// Evaluate doubled, isolated, backward, passed and connected pawns from scratch, counting the
+// terms used into trace if given
+void evaluatePawns(const Position &pos, PawnEntry &entry, EvalTrace *trace = nullptr);
@@ -1,7 +1,10 @@
 #include "position.h"
 #include "move.h"
 #include "types.h"
+#include "psqt.h"
+#include "zobrist.h"
 #include "sstream"
+#include <algorithm>
 
 static constexpr int SQ_A1 = Position::makeSquare(0, 0);
 static constexpr int SQ_E1 = Position::makeSquare(4, 0);
@@ -22,6 +25,114 @@ static constexpr int SQ_G8 = Position::makeSquare(6, 7);
 
 Position::Position() { board.fill(EMPTY); }
 
+void Position::setPiece(int sq, int piece) {
+	int old = board[sq];
+	psqtMg += PsqtMg[piece][sq] - PsqtMg[old][sq];
+	psqtEg += PsqtEg[piece][sq] - PsqtEg[old][sq];
+	phase += PhaseWeight[piece] - PhaseWeight[old];
+	key ^= Zobrist::pieceSquare[old][sq] ^ Zobrist::pieceSquare[piece][sq];
+	if (pieceType(old) == WP)
+		pawnKey ^= Zobrist::pieceSquare[old][sq];
+	if (pieceType(piece) == WP)
+		pawnKey ^= Zobrist::pieceSquare[piece][sq];
+	board[sq] = piece;
+}
+
+void Position::refreshEval() {
+	psqtMg = 0;
+	psqtEg = 0;
+	phase = 0;
+
+	for (int sq = 0; sq < 128; ++sq) {
+		if (sq & 0x88) {
+			sq += 7;
+			continue;
+		}
+		int p = board[sq];
+		psqtMg += PsqtMg[p][sq];
+		psqtEg += PsqtEg[p][sq];
+		phase += PhaseWeight[p];
+	}
+}
+
+void Position::refreshKeys() {
+	key = 0;
+	pawnKey = 0;
+
+	for (int sq = 0; sq < 128; ++sq) {
+		if (sq & 0x88) {
+			sq += 7;
+			continue;
+		}
+		int p = board[sq];
+		key ^= Zobrist::pieceSquare[p][sq];
+		if (pieceType(p) == WP)
+			pawnKey ^= Zobrist::pieceSquare[p][sq];
+	}
+
+	key ^= Zobrist::castling[castlingRights];
+	if (epSquare != -1)
+		key ^= Zobrist::epFile[epSquare & 7];
+	if (sideToMove == BLACK)
+		key ^= Zobrist::side;
+}
+
+bool Position::isRepetition(int searchPly) const {
+	const int n = static_cast<int>(stateStack.size());
+	const int limit = std::min(halfmoveClock, n);
+	int seen = 0;
+	// stateStack[n - d] holds the key from d plies ago; a position repeats 4 plies later at
+	// the earliest and only with the same side to move
+	for (int d = 4; d <= limit; d += 2) {
+		if (stateStack[n - d].key != key)
+			continue;
+		if (d <= searchPly || ++seen == 2)
+			return true;
+	}
+	return false;
+}
+
+bool Position::isInsufficientMaterial() const {
+	// Cheap rejection: a pawn, a rook or queen, or three minors
+	if (pawnKey != 0 || phase > 2)
+		return false;
+
+	int knights = 0, bishops = 0, bishopColours = 0;
+	for (int sq = 0; sq < 128; ++sq) {
+		if (sq & 0x88) {
+			sq += 7;
+			continue;
+		}
+		int pt = pieceType(board[sq]);
+		if (pt == WN) {
+			++knights;
+		} else if (pt == WB) {
+			++bishops;
+			bishopColours |= 1 << (((sq >> 4) + (sq & 7)) & 1);
+		} else if (pt != EMPTY && pt != WK) {
+			return false;
+		}
+	}
+	return knights + bishops <= 1 || (knights == 0 && bishopColours != 3);
+}
+
+bool Position::hasValidPieces() const {
+	int whiteKings = 0, blackKings = 0;
+	for (int sq = 0; sq < 128; ++sq) {
+		if (sq & 0x88) {
+			sq += 7;
+			continue;
+		}
+		const int p = board[sq];
+		whiteKings += p == WK;
+		blackKings += p == BK;
+		const int rank = sq >> 4;
+		if ((p == WP || p == BP) && (rank == 0 || rank == 7))
+			return false;
+	}
+	return whiteKings == 1 && blackKings == 1;
+}
+
 bool Position::inCheck(Color c) const {
 	int kingPiece = (c == WHITE ? WK : BK);
 	int kingSq = -1;
@@ -159,6 +270,8 @@ void Position::setStartPosition() {
 	fullmoveNumber = 1;
 
 	stateStack.clear();
+	refreshEval();
+	refreshKeys();
 }
 
 bool Position::makeMove(const Move &m) {
@@ -185,6 +298,11 @@ bool Position::makeMove(const Move &m) {
 	st.halfmoveClock = halfmoveClock;
 	st.fullmoveNumber = fullmoveNumber;
 	st.capturedPiece = capturedPiece;
+	st.psqtMg = psqtMg;
+	st.psqtEg = psqtEg;
+	st.phase = phase;
+	st.key = key;
+	st.pawnKey = pawnKey;
 	st.move = m;
 	stateStack.push_back(st);
 
@@ -217,6 +335,34 @@ bool Position::makeMove(const Move &m) {
 
 	board[to] = placedPiece;
 
+	// Incremental material + piece-square update
+	psqtMg += PsqtMg[placedPiece][to] - PsqtMg[piece][from] - PsqtMg[capturedPiece][capturedSq];
+	psqtEg += PsqtEg[placedPiece][to] - PsqtEg[piece][from] - PsqtEg[capturedPiece][capturedSq];
+	phase += PhaseWeight[placedPiece] - PhaseWeight[piece] - PhaseWeight[capturedPiece];
+
+	// Piece changes for incremental evaluators
+	DirtyPieces &dirty = stateStack.back().dirty;
+	if (placedPiece == piece) {
+		dirty.add(piece, from, to);
+	} else {
+		dirty.add(piece, from, -1);
+		dirty.add(placedPiece, -1, to);
+	}
+	if (capturedPiece != EMPTY)
+		dirty.add(capturedPiece, capturedSq, -1);
+
+	// Incremental hash update; EMPTY keys are zero
+	const u64 moved = Zobrist::pieceSquare[piece][from];
+	const u64 placed = Zobrist::pieceSquare[placedPiece][to];
+	const u64 captured = Zobrist::pieceSquare[capturedPiece][capturedSq];
+	key ^= moved ^ placed ^ captured;
+	if (pieceType(piece) == WP)
+		pawnKey ^= moved;
+	if (pieceType(placedPiece) == WP)
+		pawnKey ^= placed;
+	if (pieceType(capturedPiece) == WP)
+		pawnKey ^= captured;
+
 	// Update castling rights due to moving piece
 	switch (piece) {
 	case WK:
@@ -260,17 +406,33 @@ bool Position::makeMove(const Move &m) {
 			if (to == SQ_G1) {
 				board[SQ_F1] = WR;
 				board[SQ_H1] = EMPTY;
+				psqtMg += PsqtMg[WR][SQ_F1] - PsqtMg[WR][SQ_H1];
+				psqtEg += PsqtEg[WR][SQ_F1] - PsqtEg[WR][SQ_H1];
+				key ^= Zobrist::pieceSquare[WR][SQ_F1] ^ Zobrist::pieceSquare[WR][SQ_H1];
+				dirty.add(WR, SQ_H1, SQ_F1);
 			} else if (to == SQ_C1) {
 				board[SQ_D1] = WR;
 				board[SQ_A1] = EMPTY;
+				psqtMg += PsqtMg[WR][SQ_D1] - PsqtMg[WR][SQ_A1];
+				psqtEg += PsqtEg[WR][SQ_D1] - PsqtEg[WR][SQ_A1];
+				key ^= Zobrist::pieceSquare[WR][SQ_D1] ^ Zobrist::pieceSquare[WR][SQ_A1];
+				dirty.add(WR, SQ_A1, SQ_D1);
 			}
 		} else if (piece == BK) {
 			if (to == SQ_G8) {
 				board[SQ_F8] = BR;
 				board[SQ_H8] = EMPTY;
+				psqtMg += PsqtMg[BR][SQ_F8] - PsqtMg[BR][SQ_H8];
+				psqtEg += PsqtEg[BR][SQ_F8] - PsqtEg[BR][SQ_H8];
+				key ^= Zobrist::pieceSquare[BR][SQ_F8] ^ Zobrist::pieceSquare[BR][SQ_H8];
+				dirty.add(BR, SQ_H8, SQ_F8);
 			} else if (to == SQ_C8) {
 				board[SQ_D8] = BR;
 				board[SQ_A8] = EMPTY;
+				psqtMg += PsqtMg[BR][SQ_D8] - PsqtMg[BR][SQ_A8];
+				psqtEg += PsqtEg[BR][SQ_D8] - PsqtEg[BR][SQ_A8];
+				key ^= Zobrist::pieceSquare[BR][SQ_D8] ^ Zobrist::pieceSquare[BR][SQ_A8];
+				dirty.add(BR, SQ_A8, SQ_D8);
 			}
 		}
 	}
@@ -283,6 +445,14 @@ bool Position::makeMove(const Move &m) {
 		}
 	}
 
+	// Castling rights, en passant file and side to move
+	key ^= Zobrist::castling[st.castlingRights] ^ Zobrist::castling[castlingRights];
+	if (st.epSquare != -1)
+		key ^= Zobrist::epFile[st.epSquare & 7];
+	if (epSquare != -1)
+		key ^= Zobrist::epFile[epSquare & 7];
+	key ^= Zobrist::side;
+
 	// Swithc side to move
 	sideToMove = (sideToMove == WHITE ? BLACK : WHITE);
 
@@ -317,6 +487,11 @@ void Position::undoMove() {
 	epSquare = st.epSquare;
 	halfmoveClock = st.halfmoveClock;
 	fullmoveNumber = st.fullmoveNumber;
+	psqtMg = st.psqtMg;
+	psqtEg = st.psqtEg;
+	phase = st.phase;
+	key = st.key;
+	pawnKey = st.pawnKey;
 
 	// Undo board changes
 	if (flags & MF_CASTLING) {
@@ -487,6 +662,111 @@ std::string Position::toFEN() const {
 	return fen.str();
 }
 
+bool Position::setFromFEN(std::string_view fen) {
+	board.fill(EMPTY);
+	stateStack.clear();
+
+	size_t i = 0;
+	auto skipSpaces = [&]() {
+		while (i < fen.size() && fen[i] == ' ')
+			++i;
+	};
+
+	// 1) Piece placement (rank 8 down to 1)
+	skipSpaces();
+	int rank = 7;
+	int file = 0;
+	for (; i < fen.size() && fen[i] != ' '; ++i) {
+		char c = fen[i];
+		if (c == '/') {
+			if (file != 8 || rank == 0)
+				return false;
+			--rank;
+			file = 0;
+		} else if (c >= '1' && c <= '8') {
+			file += c - '0';
+			if (file > 8)
+				return false;
+		} else {
+			int p = fenCharToPiece(c);
+			if (p == EMPTY || file > 7)
+				return false;
+			board[makeSquare(file, rank)] = p;
+			++file;
+		}
+	}
+	if (rank != 0 || file != 8 || !hasValidPieces())
+		return false;
+
+	// 2) Side to move
+	skipSpaces();
+	if (i >= fen.size())
+		return false;
+	if (fen[i] == 'w')
+		sideToMove = WHITE;
+	else if (fen[i] == 'b')
+		sideToMove = BLACK;
+	else
+		return false;
+	++i;
+
+	// 3) Castling availability
+	skipSpaces();
+	castlingRights = 0;
+	for (; i < fen.size() && fen[i] != ' '; ++i) {
+		switch (fen[i]) {
+		case 'K':
+			castlingRights |= WK_CASTLE;
+			break;
+		case 'Q':
+			castlingRights |= WQ_CASTLE;
+			break;
+		case 'k':
+			castlingRights |= BK_CASTLE;
+			break;
+		case 'q':
+			castlingRights |= BQ_CASTLE;
+			break;
+		case '-':
+			break;
+		default:
+			return false;
+		}
+	}
+
+	// 4) En passant target square
+	skipSpaces();
+	epSquare = -1;
+	if (i < fen.size() && fen[i] != '-') {
+		if (i + 1 >= fen.size() || fen[i] < 'a' || fen[i] > 'h' || fen[i + 1] < '1' ||
+		    fen[i + 1] > '8')
+			return false;
+		epSquare = makeSquare(fen[i] - 'a', fen[i + 1] - '1');
+		i += 2;
+	} else if (i < fen.size()) {
+		++i;
+	}
+
+	// 5) + 6) Clocks, optional
+	auto readNumber = [&](int &out, int fallback) {
+		skipSpaces();
+		if (i >= fen.size() || fen[i] < '0' || fen[i] > '9') {
+			out = fallback;
+			return;
+		}
+		int n = 0;
+		while (i < fen.size() && fen[i] >= '0' && fen[i] <= '9')
+			n = n * 10 + (fen[i++] - '0');
+		out = n;
+	};
+	readNumber(halfmoveClock, 0);
+	readNumber(fullmoveNumber, 1);
+
+	refreshEval();
+	refreshKeys();
+	return true;
+}
+
 std::string Position::squareToString(int sq) {
 	if (sq < 0 || !isOnBoard(sq))
 		return "-";
@@ -533,3 +813,36 @@ char Position::pieceToFenChar(int p) {
 		return '\0'; // Unknown piece code; treat as empty (or assert)
 	}
 }
+
+int Position::fenCharToPiece(char c) {
+	switch (c) {
+	case 'P':
+		return WP;
+	case 'N':
+		return WN;
+	case 'B':
+		return WB;
+	case 'R':
+		return WR;
+	case 'Q':
+		return WQ;
+	case 'K':
+		return WK;
+
+	case 'p':
+		return BP;
+	case 'n':
+		return BN;
+	case 'b':
+		return BB;
+	case 'r':
+		return BR;
+	case 'q':
+		return BQ;
+	case 'k':
+		return BK;
+
+	default:
+		return EMPTY;
+	}
+}
@@ -4,6 +4,7 @@
 #include <array>
 #include <vector>
 #include <string>
+#include <string_view>
 
 static constexpr int KnightOffsets[8] = {31, 33, 18, 14, -31, -33, -18, -14};
 static constexpr int BishopOffsets[4] = {17, 15, -17, -15};
@@ -17,6 +18,22 @@ enum CastleRights {
 	BQ_CASTLE = 1 << 3
 };
 
+// Pieces moved, added or removed by one move, for incremental evaluators. from is -1 for a
+// piece that appears (promotion), to is -1 for one that disappears (capture, promoted pawn).
+struct DirtyPieces {
+	int count = 0;
+	int8_t piece[3];
+	int8_t from[3];
+	int8_t to[3];
+
+	void add(int p, int f, int t) {
+		piece[count] = static_cast<int8_t>(p);
+		from[count] = static_cast<int8_t>(f);
+		to[count] = static_cast<int8_t>(t);
+		++count;
+	}
+};
+
 class Position {
   public:
 	std::array<int, 128> board{};
@@ -26,12 +43,28 @@ class Position {
 	int halfmoveClock = 0;
 	int fullmoveNumber = 1;
 
+	// Incremental evaluation terms (White's point of view): material + piece-square sums for
+	// middlegame and endgame, and the game phase used to blend them.
+	int psqtMg = 0;
+	int psqtEg = 0;
+	int phase = 0;
+
+	// Zobrist hash of the full position and of the pawns alone
+	u64 key = 0;
+	u64 pawnKey = 0;
+
 	struct State {
 		int castlingRights;
 		int epSquare;
 		int halfmoveClock;
 		int fullmoveNumber;
 		int capturedPiece;
+		int psqtMg;
+		int psqtEg;
+		int phase;
+		u64 key;
+		u64 pawnKey;
+		DirtyPieces dirty;
 		Move move;
 	};
 
@@ -47,7 +80,13 @@ class Position {
 
 	int pieceAt(int sq) const { return board[sq]; }
 
-	void setPiece(int sq, int piece) { board[sq] = piece; }
+	void setPiece(int sq, int piece);
+
+	// Recompute the incremental evaluation terms from the board
+	void refreshEval();
+
+	// Recompute key and pawnKey from scratch
+	void refreshKeys();
 
 	bool makeMove(const Move &m); // return false if illegal
 	void undoMove();              // undo last move
@@ -56,9 +95,31 @@ class Position {
 
 	bool inCheck(Color c) const; // might be needed for legal move generation
 
+	// The position occurred before since the last capture or pawn move. An occurrence within
+	// the last searchPly plies (inside the search tree) is enough, older ones must be seen
+	// twice as for a threefold repetition.
+	bool isRepetition(int searchPly = 0) const;
+
+	// 100 plies without a capture or pawn move
+	bool isFiftyMoveDraw() const { return halfmoveClock >= 100; }
+
+	// Neither side can mate: bare kings, a single minor piece, or only bishops on squares of
+	// one colour
+	bool isInsufficientMaterial() const;
+
+	// Exactly one king per side and no pawn on the first or last rank, which the search and
+	// evaluation rely on
+	bool hasValidPieces() const;
+
 	std::string toFEN() const;
 
+	// Set up the position from a FEN string; the move counters are optional.
+	// Returns false (leaving the position unspecified) on malformed input or when the pieces
+	// fail hasValidPieces().
+	bool setFromFEN(std::string_view fen);
+
   private:
 	static char pieceToFenChar(int p);
+	static int fenCharToPiece(char c);
 	static std::string squareToString(int sq);
 };
@@ -0,0 +1,276 @@
+#include "protocol.h"
+#include "framing.h"
+#include "utils.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace {
+
+std::string statusToString(GameResult r) {
+	switch (r) {
+	case GameResult::ONGOING:
+		return "ongoing";
+	case GameResult::CHECKMATE:
+		return "checkmate";
+	case GameResult::STALEMATE:
+		return "stalemate";
+	case GameResult::REPETITION:
+		return "repetition";
+	case GameResult::FIFTY_MOVES:
+		return "fifty-moves";
+	case GameResult::INSUFFICIENT_MATERIAL:
+		return "insufficient-material";
+	}
+	return "ongoing";
+}
+
+json stateJson(const EngineSession &s) {
+	json j;
+	j["event"] = "state";
+	j["fen"] = s.position().toFEN();
+	j["side_to_move"] = (s.sideToMove() == WHITE ? "w" : "b");
+	j["status"] = statusToString(s.getGameResult());
+	return j;
+}
+
+json legalMovesJson(const EngineSession &s) {
+	json moves = json::array();
+	for (const Move &m : s.legalMoves())
+		moves.push_back(MoveToUci(m));
+	json j = stateJson(s);
+	j["event"] = "legal-moves";
+	j["moves"] = std::move(moves);
+	return j;
+}
+
+json pvLinesJson(const std::vector<PVLine> &lines) {
+	json arr = json::array();
+	for (size_t i = 0; i < lines.size(); ++i) {
+		json pv = json::array();
+		for (const Move &m : lines[i].moves)
+			pv.push_back(MoveToUci(m));
+		arr.push_back({{"rank", i + 1},
+		               {"depth", lines[i].depth},
+		               {"score", lines[i].score},
+		               {"pv", pv}});
+	}
+	return arr;
+}
+
+json statsJson(const SearchStats &st) {
+	return json{{"nodes", st.nodes},
+	            {"seldepth", st.seldepth},
+	            {"pawn_hash_probes", st.pawnProbes},
+	            {"pawn_hash_hit_rate", st.pawnHitRate()},
+	            {"eval_cache_hit_rate", st.evalHitRate()},
+	            {"tt_hit_rate", st.ttHitRate()},
+	            {"nnue_evals", st.nnueEvals},
+	            {"nnue_refresh_rate", st.nnueRefreshRate()}};
+}
+
+// Totals of every process using the session's shared table
+json sharedHashJson(const TranspositionTable &tt) {
+	TranspositionTable::SharedStats st;
+	tt.sharedStats(st);
+	return json{{"attached", st.attached},
+	            {"probes", st.probes},
+	            {"hits", st.hits},
+	            {"hit_rate", st.hitRate()}};
+}
+
+json infoJson(const SearchInfo &info) {
+	json pv = json::array();
+	for (const Move &m : info.pv)
+		pv.push_back(MoveToUci(m));
+	return json{{"event", "info"},
+	            {"depth", info.depth},
+	            {"seldepth", info.seldepth},
+	            {"score", info.score},
+	            {"nodes", info.nodes},
+	            {"nps", info.nps},
+	            {"time_ms", info.timeMs},
+	            {"hashfull", info.hashfull},
+	            {"pv", pv}};
+}
+
+} // namespace
+
+json protocolError(const std::string &message) {
+	return json{{"event", "error"}, {"message", message}};
+}
+
+void tagResponse(json &response, const json &req) {
+	auto id = req.find("id");
+	if (id != req.end())
+		response["id"] = *id;
+}
+
+json handleProtocolRequest(EngineSession &session, const json &req, const ProtocolEmitter &emit) {
+	const std::string cmd = req.value("cmd", "");
+	InfoReporter info;
+	if (emit && req.value("info", true))
+		info = [&](const SearchInfo &i) { emit(infoJson(i)); };
+	if (cmd == "state")
+		return stateJson(session);
+
+	if (cmd == "legal-moves")
+		return legalMovesJson(session);
+
+	if (cmd == "new-game") {
+		std::string hc = req.value("human_color", "w");
+		Color human = (hc.size() && (hc[0] == 'b' || hc[0] == 'B')) ? BLACK : WHITE;
+		session.newGame(human);
+		return stateJson(session);
+	}
+
+	if (cmd == "move") {
+		std::string mv = req.value("move", "");
+		Move hm{};
+		std::string err;
+		if (!session.applyHumanMove(mv, hm, err))
+			return protocolError(err);
+
+		// If human move ended game, report state immediately.
+		if (session.getGameResult() != GameResult::ONGOING)
+			return stateJson(session);
+
+		Move em{};
+		if (!session.applyEngineMove(em, info))
+			return protocolError("engine failed to move");
+
+		auto out = stateJson(session);
+		out["engine_move"] = MoveToUci(em);
+		out["stats"] = statsJson(session.lastSearchStats());
+		if (session.hashTable().isShared())
+			out["shared_hash"] = sharedHashJson(session.hashTable());
+		return out;
+	}
+
+	if (cmd == "analyze") {
+		int multiPV = req.value("multipv", session.engineConfig().multiPV);
+		std::vector<PVLine> lines;
+		if (!session.analyze(multiPV, lines, nullptr, info))
+			return protocolError("nothing to analyze");
+
+		auto out = stateJson(session);
+		out["event"] = "analysis";
+		out["lines"] = pvLinesJson(lines);
+		out["stats"] = statsJson(session.lastSearchStats());
+		if (session.hashTable().isShared())
+			out["shared_hash"] = sharedHashJson(session.hashTable());
+		return out;
+	}
+
+	return protocolError("unknown cmd");
+}
+
+int runProtocol(const EngineConfig &cfg) {
+	EngineSession session(cfg);
+
+	std::mutex outMutex;
+	WireFormat format = WireFormat::JSON_LINES;
+	auto send = [&](const json &out) {
+		std::lock_guard<std::mutex> lock(outMutex);
+		writeAll(STDOUT_FILENO, encodeMessage(out, format));
+	};
+
+	// Queued requests for the worker, and the state published after each one it finishes
+	std::mutex mutex;
+	std::condition_variable requestReady;
+	std::deque<json> queue;
+	json published = stateJson(session);
+	json publishedMoves = legalMovesJson(session);
+	bool searching = false;
+	bool inputDone = false;
+
+	std::thread worker([&] {
+		while (true) {
+			json req;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				requestReady.wait(lock, [&] { return !queue.empty() || inputDone; });
+				if (queue.empty())
+					return;
+				req = std::move(queue.front());
+				queue.pop_front();
+				searching = true;
+			}
+
+			auto emit = [&](json event) {
+				tagResponse(event, req);
+				send(event);
+			};
+			json out;
+			try {
+				out = handleProtocolRequest(session, req, emit);
+			} catch (const std::exception &e) {
+				out = protocolError(e.what());
+			}
+			tagResponse(out, req);
+			json state = stateJson(session);
+			json moves = legalMovesJson(session);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				published = std::move(state);
+				publishedMoves = std::move(moves);
+				searching = false;
+			}
+			send(out);
+		}
+	});
+
+	MessageReader reader(STDIN_FILENO);
+	json req;
+	for (bool first = true;; first = false) {
+		MessageReader::Result result = reader.next(format, req);
+		if (result == MessageReader::END)
+			break;
+		if (result == MessageReader::INVALID) {
+			send(protocolError("invalid json"));
+			continue;
+		}
+		json reply;
+		WireFormat negotiated = format;
+		if (first && negotiateWireFormat(req, negotiated, reply)) {
+			send(reply);
+			std::lock_guard<std::mutex> lock(outMutex);
+			format = negotiated;
+			continue;
+		}
+		if (!req.is_object()) {
+			send(protocolError("request must be an object"));
+			continue;
+		}
+
+		const std::string cmd = req.value("cmd", "");
+		if (cmd == "state" || cmd == "legal-moves") {
+			json out;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				out = cmd == "state" ? published : publishedMoves;
+				out["busy"] = searching || !queue.empty();
+			}
+			tagResponse(out, req);
+			send(out);
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(std::move(req));
+		requestReady.notify_one();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		inputDone = true;
+	}
+	requestReady.notify_all();
+	worker.join();
+	return 0;
+}
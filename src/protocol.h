@@ -0,0 +1,34 @@
+#pragma once
+#include "engine_session.h"
+#include <functional>
+#include <nlohmann/json.hpp>
+
+// JSON-lines protocol spoken by `chess --protocol` (one game per process) and `chess --server`
+// (many games per process). Requests are objects with a "cmd" of "new-game", "move",
+// "analyze", "state" or "legal-moves"; every request gets one response object with an "event"
+// of "state", "analysis", "legal-moves" (the state plus "moves" in UCI form) or "error",
+// preceded by any "info" events of its search. Moves are UCI strings ("e2e4", "e7e8q") both
+// ways, including the "engine_move" of a "move" response. A request's "id", of any JSON type,
+// is copied into its response and its info events.
+// Messages are JSON lines unless a binary framing is negotiated first (see framing.h).
+
+using ProtocolEmitter = std::function<void(nlohmann::json event)>;
+
+// Apply one request to a session and return its response, without the id. While a "move" or
+// "analyze" searches, rate-limited "info" events with the depth, seldepth, score, nodes, nps,
+// hashfull and pv so far go to emit, also without the id. A request with "info": false gets
+// none.
+nlohmann::json handleProtocolRequest(EngineSession &session, const nlohmann::json &req,
+                                     const ProtocolEmitter &emit = nullptr);
+
+nlohmann::json protocolError(const std::string &message);
+
+// Copy the request id, if any, into a response
+void tagResponse(nlohmann::json &response, const nlohmann::json &req);
+
+// Serve a single session over standard input and output. Requests that change the session run
+// in order on a worker thread while "state" and "legal-moves" are answered at once from the
+// position after the last finished request, so responses can arrive out of request order.
+// With cfg.sharedHash set, "move" and "analyze" responses also carry "shared_hash": the
+// processes attached to the table and their combined probes, hits and hit_rate.
+int runProtocol(const EngineConfig &cfg = EngineConfig());
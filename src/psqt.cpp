@@ -0,0 +1,35 @@
+#include "psqt.h"
+#include "eval_params.h"
+
+int PsqtMg[13][128];
+int PsqtEg[13][128];
+
+void refreshPsqtTables() {
+	for (int pt = WP; pt <= WK; ++pt) {
+		for (int rank = 0; rank < 8; ++rank) {
+			for (int file = 0; file < 8; ++file) {
+				int sq = (rank << 4) | file;
+				int material = TERM_MATERIAL + pt - WP;
+				int whiteTerm = TERM_PSQT + (pt - WP) * 64 + rank * 8 + file;
+				int blackTerm = TERM_PSQT + (pt - WP) * 64 + (7 - rank) * 8 + file; // mirrored
+
+				int materialMg = pt == WK ? 0 : paramMg(material);
+				int materialEg = pt == WK ? 0 : paramEg(material);
+				PsqtMg[pt][sq] = materialMg + paramMg(whiteTerm);
+				PsqtEg[pt][sq] = materialEg + paramEg(whiteTerm);
+				PsqtMg[pt + BP - WP][sq] = -(materialMg + paramMg(blackTerm));
+				PsqtEg[pt + BP - WP][sq] = -(materialEg + paramEg(blackTerm));
+			}
+		}
+	}
+}
+
+namespace {
+
+struct PsqtInit {
+	PsqtInit() { refreshPsqtTables(); }
+};
+
+const PsqtInit psqtInit;
+
+} // namespace
@@ -0,0 +1,16 @@
+#pragma once
+#include "types.h"
+
+// Material plus piece-square values indexed by [piece][0x88 square], already signed from
+// White's point of view (black entries are mirrored and negated). Position keeps their sum
+// up to date in makeMove/undoMove.
+extern int PsqtMg[13][128];
+extern int PsqtEg[13][128];
+
+// Rebuild the tables from evalParams; positions set up earlier keep stale sums until
+// Position::refreshEval
+void refreshPsqtTables();
+
+// Game phase contribution per piece; a full board adds up to MAX_PHASE
+static constexpr int PhaseWeight[13] = {0, 0, 1, 1, 2, 4, 0, 0, 1, 1, 2, 4, 0};
+static constexpr int MAX_PHASE = 24;
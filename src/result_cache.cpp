@@ -0,0 +1,99 @@
+#include "result_cache.h"
+
+bool ResultCache::Entry::satisfies(int maxDepth, int limitMs, u64 limitNodes) const {
+	if (lines.empty())
+		return false;
+	return depth() >= maxDepth || (limitMs > 0 && timeMs >= limitMs) ||
+	       (limitNodes > 0 && nodes >= limitNodes);
+}
+
+void ResultCache::setCapacity(size_t capacityBytes) {
+	std::lock_guard<std::mutex> lock(mutex);
+	capacity = capacityBytes;
+	evictLocked();
+}
+
+bool ResultCache::enabled() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return capacity > 0;
+}
+
+bool ResultCache::probe(u64 key, int multiPV, Entry &out) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (capacity == 0)
+		return false;
+	++counters.probes;
+	auto it = index.find(Key{key, multiPV});
+	if (it == index.end())
+		return false;
+	lru.splice(lru.begin(), lru, it->second);
+	out = it->second->entry;
+	return true;
+}
+
+void ResultCache::store(u64 key, int multiPV, Entry entry) {
+	if (entry.lines.empty())
+		return;
+	std::lock_guard<std::mutex> lock(mutex);
+	if (capacity == 0)
+		return;
+
+	const Key k{key, multiPV};
+	auto it = index.find(k);
+	if (it != index.end()) {
+		Node &node = *it->second;
+		lru.splice(lru.begin(), lru, it->second);
+		if (node.entry.depth() > entry.depth())
+			return;
+		bytes -= node.bytes;
+		node.entry = std::move(entry);
+		node.bytes = nodeBytes(node.entry);
+		bytes += node.bytes;
+	} else {
+		const size_t size = nodeBytes(entry);
+		lru.push_front(Node{k, std::move(entry), size});
+		index.emplace(k, lru.begin());
+		bytes += size;
+	}
+	evictLocked();
+}
+
+void ResultCache::recordHit() {
+	std::lock_guard<std::mutex> lock(mutex);
+	++counters.hits;
+}
+
+void ResultCache::recordSeed() {
+	std::lock_guard<std::mutex> lock(mutex);
+	++counters.seeds;
+}
+
+ResultCache::Stats ResultCache::stats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	Stats s = counters;
+	s.entries = index.size();
+	s.bytes = bytes;
+	s.capacity = capacity;
+	return s;
+}
+
+// The list node, the lines and their moves, and roughly one hash bucket and index node
+size_t ResultCache::nodeBytes(const Entry &entry) {
+	size_t size = sizeof(Node) + 4 * sizeof(void *) + sizeof(Key);
+	for (const PVLine &line : entry.lines)
+		size += sizeof(PVLine) + line.moves.capacity() * sizeof(Move);
+	return size;
+}
+
+void ResultCache::evictLocked() {
+	while (bytes > capacity && !lru.empty()) {
+		bytes -= lru.back().bytes;
+		index.erase(lru.back().key);
+		lru.pop_back();
+	}
+}
+
+ResultCache &resultCache() {
+	static ResultCache cache;
+	return cache;
+}
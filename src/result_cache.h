@@ -0,0 +1,76 @@
+#pragma once
+#include "search.h"
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Finished root searches shared by every session in the process, so positions that many games
+// reach are not searched from scratch each time. Entries are keyed by the position's Zobrist
+// key and the number of lines asked for, and evicted least recently used first once the
+// capacity is exceeded. A capacity of 0 (the default) disables the cache.
+class ResultCache {
+  public:
+	// What one search achieved: its ranked lines, all searched to the same depth, and the
+	// time and nodes it spent getting there
+	struct Entry {
+		std::vector<PVLine> lines;
+		int timeMs = 0;
+		u64 nodes = 0;
+
+		int depth() const { return lines.empty() ? 0 : lines.front().depth; }
+		// A search limited to maxDepth, timeMs and nodes (0 for none) would get no further
+		bool satisfies(int maxDepth, int limitMs, u64 limitNodes) const;
+	};
+
+	struct Stats {
+		u64 probes = 0;
+		u64 hits = 0;     // entries that answered a search outright
+		u64 seeds = 0;    // shallower entries a search resumed from
+		size_t entries = 0;
+		size_t bytes = 0;
+		size_t capacity = 0;
+	};
+
+	void setCapacity(size_t bytes);
+	bool enabled() const;
+
+	bool probe(u64 key, int multiPV, Entry &out);
+	// Replaces an existing entry only with a deeper one
+	void store(u64 key, int multiPV, Entry entry);
+
+	void recordHit();
+	void recordSeed();
+	Stats stats() const;
+
+  private:
+	struct Key {
+		u64 key;
+		int multiPV;
+		bool operator==(const Key &o) const { return key == o.key && multiPV == o.multiPV; }
+	};
+	struct KeyHash {
+		size_t operator()(const Key &k) const {
+			return static_cast<size_t>(k.key ^ (static_cast<u64>(k.multiPV) << 56));
+		}
+	};
+	struct Node {
+		Key key;
+		Entry entry;
+		size_t bytes;
+	};
+
+	static size_t nodeBytes(const Entry &entry);
+	void evictLocked();
+
+	mutable std::mutex mutex;
+	std::list<Node> lru; // most recently used first
+	std::unordered_map<Key, std::list<Node>::iterator, KeyHash> index;
+	size_t capacity = 0;
+	size_t bytes = 0;
+	Stats counters;
+};
+
+// The process-wide cache
+ResultCache &resultCache();
@@ -1,87 +1,242 @@
 #include "search.h"
 #include "movegen.h"
+#include "evaluate.h"
+#include "pawns.h"
+#include "nnue.h"
+#include "tt.h"
 #include <vector>
 #include <limits>
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 
-static const int PAWN_VALUE = 100;
-static const int KNIGHT_VALUE = 320;
-static const int BISHOP_VALUE = 330;
-static const int ROOK_VALUE = 500;
-static const int QUEEN_VALUE = 900;
+static const int INF = MATE_SCORE + 1;
 
-static const int MATE_SCORE = 100000;
-static const int MATE_IN_MAX = MATE_SCORE - 1000; // reserved if needed later
+// The TT holds mate scores relative to the entry's position rather than the root, so an entry
+// reached at another ply still reports the right distance
+static int scoreToTT(int score, int ply) {
+	return score >= MATE_IN_MAX ? score + ply : score <= -MATE_IN_MAX ? score - ply : score;
+}
 
-int evaluateMaterial(const Position &pos) {
-	int score = 0;
+static int scoreFromTT(int score, int ply) {
+	return score >= MATE_IN_MAX ? score - ply : score <= -MATE_IN_MAX ? score + ply : score;
+}
 
-	for (int sq = 0; sq < 128; ++sq) {
-		if (sq & 0x88) {
-			sq += 7;
-			continue;
-		}
-		int p = pos.board[sq];
-		switch (p) {
-		case WP:
-			score += PAWN_VALUE;
-			break;
-		case WN:
-			score += KNIGHT_VALUE;
-			break;
-		case WB:
-			score += BISHOP_VALUE;
-			break;
-		case WR:
-			score += ROOK_VALUE;
-			break;
-		case WQ:
-			score += QUEEN_VALUE;
-			break;
-		case WK:
-			break; // king value handled via mate scores
+// Nodes between clock reads
+static const u64 TIME_CHECK_INTERVAL = 1024;
 
-		case BP:
-			score -= PAWN_VALUE;
-			break;
-		case BN:
-			score -= KNIGHT_VALUE;
-			break;
-		case BB:
-			score -= BISHOP_VALUE;
-			break;
-		case BR:
-			score -= ROOK_VALUE;
-			break;
-		case BQ:
-			score -= QUEEN_VALUE;
-			break;
-		case BK:
-			break;
+// Victim value for MVV-LVA ordering, by piece type
+static const int VictimValue[7] = {0, 100, 320, 330, 500, 900, 0};
+
+// Simple move ordering: captures first
+static void orderMoves(std::vector<Move> &moves) {
+	std::stable_sort(moves.begin(), moves.end(), [](const Move &a, const Move &b) {
+		bool ca = (a.flags & MF_CAPTURE) != 0;
+		bool cb = (b.flags & MF_CAPTURE) != 0;
+		return ca > cb;
+	});
+}
+
+// Move the hash move, if present, to the front
+static void promoteHashMove(std::vector<Move> &moves, uint16_t hashMove) {
+	if (hashMove == 0)
+		return;
+	for (size_t i = 0; i < moves.size(); ++i) {
+		if (packMove(moves[i]) == hashMove) {
+			std::rotate(moves.begin(), moves.begin() + i, moves.begin() + i + 1);
+			return;
 		}
 	}
+}
+
+const std::vector<SearchParamSpec> SearchParamSpecs = {
+    {"aspiration_window", &SearchParams::aspirationWindow, 10, 200, 8},
+    {"delta_margin", &SearchParams::deltaMargin, 50, 600, 25},
+    {"lmr_min_depth", &SearchParams::lmrMinDepth, 2, 6, 0.5},
+    {"lmr_min_moves", &SearchParams::lmrMinMoves, 1, 10, 0.75},
+    {"lmr_base", &SearchParams::lmrBase, 0, 200, 10},
+    {"lmr_divisor", &SearchParams::lmrDivisor, 100, 500, 20},
+    {"time_moves_to_go", &SearchParams::timeMovesToGo, 10, 60, 3},
+    {"time_inc_percent", &SearchParams::timeIncPercent, 25, 100, 5},
+};
+
+int allocateTime(const SearchParams &params, int remainingMs, int incMs) {
+	int ms = remainingMs / std::max(1, params.timeMovesToGo) + incMs * params.timeIncPercent / 100;
+	// Never plan to use more than most of what is left
+	return std::max(1, std::min(ms, remainingMs * 3 / 4));
+}
+
+// Report the best line of the last completed depth unless one went out too recently
+static void reportInfo(SearchContext &ctx, std::chrono::steady_clock::time_point now, bool force) {
+	if (ctx.bestLine.moves.empty())
+		return;
+	if (!force && now - ctx.lastInfoTime < std::chrono::milliseconds(ctx.infoIntervalMs))
+		return;
+	ctx.lastInfoTime = now;
+
+	SearchInfo info;
+	info.depth = ctx.bestLine.depth;
+	info.seldepth = ctx.stats.seldepth;
+	info.score = ctx.bestLine.score;
+	info.nodes = ctx.stats.nodes;
+	const auto elapsed =
+	    std::chrono::duration_cast<std::chrono::microseconds>(now - ctx.startTime).count();
+	info.timeMs = static_cast<int>(elapsed / 1000);
+	info.nps = elapsed > 0 ? ctx.stats.nodes * 1000000 / static_cast<u64>(elapsed) : 0;
+	info.hashfull = ctx.tt ? ctx.tt->hashfull() : 0;
+	info.pv = ctx.bestLine.moves;
+	ctx.info(info);
+}
+
+static bool checkTime(SearchContext &ctx) {
+	if (ctx.limits.maxNodes && ctx.stats.nodes >= ctx.limits.maxNodes)
+		ctx.timeUp = true;
+	if ((ctx.stats.nodes % TIME_CHECK_INTERVAL) != 0)
+		return ctx.timeUp;
+	if (ctx.limits.stop && ctx.limits.stop->load(std::memory_order_relaxed))
+		ctx.timeUp = true;
+	if (ctx.limits.useTime || ctx.info) {
+		const auto now = std::chrono::steady_clock::now();
+		const bool pondering =
+		    ctx.limits.ponder && ctx.limits.ponder->load(std::memory_order_relaxed);
+		if (ctx.limits.useTime && !pondering && now >= ctx.limits.endTime)
+			ctx.timeUp = true;
+		if (ctx.info)
+			reportInfo(ctx, now, false);
+	}
+	return ctx.timeUp;
+}
+
+static void updateSeldepth(const Position &pos, SearchContext &ctx) {
+	const int ply = static_cast<int>(pos.stateStack.size() - ctx.rootPly);
+	if (ply > ctx.stats.seldepth)
+		ctx.stats.seldepth = ply;
+}
 
-	// Score from POV of side to move
-	if (pos.sideToMove == WHITE)
+// Late move reduction in plies for the moveNumber-th move (1-based) at this depth
+static int lmrReduction(const SearchParams &params, int depth, int moveNumber) {
+	double r = params.lmrBase / 100.0 +
+	           std::log(depth) * std::log(moveNumber) * 100.0 / std::max(1, params.lmrDivisor);
+	return static_cast<int>(r);
+}
+
+static int staticEval(const Position &pos, SearchContext &ctx) {
+	if (!ctx.evalCache)
+		return evaluate(pos);
+
+	++ctx.stats.evalProbes;
+	int score;
+	if (ctx.evalCache->probe(pos.key, score)) {
+		++ctx.stats.evalHits;
 		return score;
-	else
-		return -score;
-}
-
-int alphaBeta(Position &pos, int depth, int alpha, int beta, const SearchLimits &limits,
-              bool &timeUp) {
-	// Time check at node entry
-	if (limits.useTime) {
-		auto now = std::chrono::steady_clock::now();
-		if (now >= limits.endTime) {
-			timeUp = true;
-			return 0; // value will be ignored by caller when timeUp is true
+	}
+	score = evaluate(pos);
+	ctx.evalCache->store(pos.key, score);
+	return score;
+}
+
+int quiescence(Position &pos, int alpha, int beta, SearchContext &ctx, std::vector<Move> *pv) {
+	if (pv)
+		pv->clear();
+	++ctx.stats.nodes;
+	updateSeldepth(pos, ctx);
+	if (checkTime(ctx))
+		return 0;
+
+	int standPat = staticEval(pos, ctx);
+	if (standPat >= beta)
+		return standPat;
+	if (standPat > alpha)
+		alpha = standPat;
+
+	std::vector<Move> moves;
+	GeneratePseudoLegalMoves(pos, moves);
+	moves.erase(std::remove_if(moves.begin(), moves.end(),
+	                           [](const Move &m) {
+		                           return (m.flags & (MF_CAPTURE | MF_PROMOTION)) == 0;
+	                           }),
+	            moves.end());
+
+	// MVV-LVA: most valuable victim first, cheapest attacker breaking ties
+	std::sort(moves.begin(), moves.end(), [](const Move &a, const Move &b) {
+		int va = VictimValue[pieceType(a.captured)] * 8 - pieceType(a.piece);
+		int vb = VictimValue[pieceType(b.captured)] * 8 - pieceType(b.piece);
+		return va > vb;
+	});
+
+	int bestScore = standPat;
+	std::vector<Move> childPv;
+	for (const Move &m : moves) {
+		// Delta pruning: even winning the victim for free would not reach alpha
+		if (!(m.flags & MF_PROMOTION) &&
+		    standPat + VictimValue[pieceType(m.captured)] + ctx.params.deltaMargin <= alpha)
+			continue;
+
+		if (!pos.makeMove(m))
+			continue;
+
+		int score = -quiescence(pos, -beta, -alpha, ctx, pv ? &childPv : nullptr);
+
+		pos.undoMove();
+
+		if (ctx.timeUp)
+			return 0;
+
+		if (score > bestScore) {
+			bestScore = score;
+			if (score > alpha) {
+				alpha = score;
+				if (pv) {
+					pv->assign(1, m);
+					pv->insert(pv->end(), childPv.begin(), childPv.end());
+				}
+			}
 		}
+		if (alpha >= beta)
+			break;
 	}
 
+	return bestScore;
+}
+
+int alphaBeta(Position &pos, int depth, int alpha, int beta, SearchContext &ctx,
+              std::vector<Move> &pv) {
+	pv.clear();
+
 	if (depth == 0) {
-		return evaluateMaterial(pos);
+		return quiescence(pos, alpha, beta, ctx);
+	}
+
+	++ctx.stats.nodes;
+	updateSeldepth(pos, ctx);
+
+	// Time check
+	if (checkTime(ctx))
+		return 0; // value will be ignored by caller when timeUp is true
+
+	// Drawn lines end before any table lookups; the root is never scored here
+	const int ply = static_cast<int>(pos.stateStack.size() - ctx.rootPly);
+	if (pos.isRepetition(ply) || pos.isInsufficientMaterial())
+		return 0;
+
+	const int alphaOrig = alpha;
+	uint16_t hashMove = 0;
+	if (ctx.tt) {
+		++ctx.stats.ttProbes;
+		TTEntry entry;
+		if (ctx.tt->probe(pos.key, entry)) {
+			++ctx.stats.ttHits;
+			hashMove = entry.move;
+			const int score = scoreFromTT(entry.score, ply);
+			if (entry.depth >= depth) {
+				if (entry.bound == BOUND_EXACT)
+					return score;
+				if (entry.bound == BOUND_LOWER && score >= beta)
+					return score;
+				if (entry.bound == BOUND_UPPER && score <= alpha)
+					return score;
+			}
+		}
 	}
 
 	std::vector<Move> moves;
@@ -89,41 +244,61 @@ int alphaBeta(Position &pos, int depth, int alpha, int beta, const SearchLimits
 
 	if (moves.empty()) {
 		if (pos.inCheck(pos.sideToMove)) {
-			// Side to move is checkmated -> very bad for them.
-			return -MATE_SCORE;
+			// Side to move is checkmated -> very bad for them, less so the later it happens
+			return -MATE_SCORE + ply;
 		} else {
 			// Stalemate = draw
 			return 0;
 		}
 	}
+	// Checkmate on the hundredth ply still wins, so this waits for the move list
+	if (pos.isFiftyMoveDraw())
+		return 0;
 
-	int bestScore = std::numeric_limits<int>::min();
+	int bestScore = -INF;
+	uint16_t bestMove = 0;
+	std::vector<Move> childPv;
 
-	// Simple move ordering: captures first
-	std::stable_sort(moves.begin(), moves.end(), [](const Move &a, const Move &b) {
-		bool ca = (a.flags & MF_CAPTURE) != 0;
-		bool cb = (b.flags & MF_CAPTURE) != 0;
-		return ca > cb;
-	});
+	orderMoves(moves);
+	promoteHashMove(moves, hashMove);
 
+	const bool inCheck = pos.inCheck(pos.sideToMove);
+	int moveNumber = 0;
 	for (const Move &m : moves) {
 		if (!pos.makeMove(m))
 			continue;
+		++moveNumber;
+
+		// Late quiet moves are searched shallower first and re-searched if they beat alpha
+		int score;
+		int reduction = 0;
+		if (depth >= ctx.params.lmrMinDepth && moveNumber > ctx.params.lmrMinMoves &&
+		    !inCheck && !(m.flags & (MF_CAPTURE | MF_PROMOTION)) && !pos.inCheck(pos.sideToMove))
+			reduction = std::clamp(lmrReduction(ctx.params, depth, moveNumber), 0, depth - 2);
 
-		int score = -alphaBeta(pos, depth - 1, -beta, -alpha, limits, timeUp);
+		if (reduction > 0) {
+			score = -alphaBeta(pos, depth - 1 - reduction, -alpha - 1, -alpha, ctx, childPv);
+			if (score > alpha && !ctx.timeUp)
+				score = -alphaBeta(pos, depth - 1, -beta, -alpha, ctx, childPv);
+		} else {
+			score = -alphaBeta(pos, depth - 1, -beta, -alpha, ctx, childPv);
+		}
 
 		pos.undoMove();
 
-		if (timeUp) {
+		if (ctx.timeUp) {
 			// Time is up; abort search in this branch
 			return 0;
 		}
 
 		if (score > bestScore) {
 			bestScore = score;
-		}
-		if (bestScore > alpha) {
-			alpha = bestScore;
+			bestMove = packMove(m);
+			if (score > alpha) {
+				alpha = score;
+				pv.assign(1, m);
+				pv.insert(pv.end(), childPv.begin(), childPv.end());
+			}
 		}
 		if (alpha >= beta) {
 			// Beta cutoff
@@ -131,69 +306,215 @@ int alphaBeta(Position &pos, int depth, int alpha, int beta, const SearchLimits
 		}
 	}
 
+	if (ctx.tt) {
+		TTBound bound = bestScore >= beta       ? BOUND_LOWER
+		                : bestScore > alphaOrig ? BOUND_EXACT
+		                                        : BOUND_UPPER;
+		ctx.tt->store(pos.key, scoreToTT(bestScore, ply), depth, bound, bestMove);
+	}
+
 	return bestScore;
 }
 
-bool searchBestMove(Position &pos, int maxDepth, const SearchLimits &limits, Move &bestMove) {
+namespace {
+
+struct RootMove {
+	Move move;
+	int score = -INF;
+	int prevScore = -INF;
+	std::vector<Move> pv;
+};
+
+} // namespace
+
+// Searches rootMoves[first..] inside (alpha, beta). Moves before first belong to lines already
+// found this iteration and are skipped. Returns the best score (fail-soft).
+static int searchRootMoves(Position &pos, std::vector<RootMove> &rootMoves, size_t first,
+                           int depth, int alpha, int beta, SearchContext &ctx) {
+	int bestScore = -INF;
+	std::vector<Move> childPv;
+
+	for (size_t i = first; i < rootMoves.size(); ++i)
+		rootMoves[i].score = -INF;
+
+	for (size_t i = first; i < rootMoves.size(); ++i) {
+		RootMove &rm = rootMoves[i];
+		if (!pos.makeMove(rm.move))
+			continue;
+
+		int score = -alphaBeta(pos, depth - 1, -beta, -alpha, ctx, childPv);
+
+		pos.undoMove();
+
+		if (ctx.timeUp)
+			return 0;
+
+		rm.score = score;
+		if (score > bestScore)
+			bestScore = score;
+		if (score > alpha) {
+			alpha = score;
+			rm.pv.assign(1, rm.move);
+			rm.pv.insert(rm.pv.end(), childPv.begin(), childPv.end());
+		}
+		if (alpha >= beta)
+			break;
+	}
+
+	return bestScore;
+}
+
+// Start from ctx.seed: its lines go first in rank order, their moves become hash moves along
+// each PV where the table knows nothing of the position yet, and they stand as the result
+// until a deeper iteration completes. Returns their depth, 0 when the seed does not fit this
+// position. Iterating from depth 1 again still costs fewer nodes than jumping straight past
+// the seed with an otherwise cold table.
+static int applySeed(Position &pos, std::vector<RootMove> &rootMoves, size_t lineCount,
+                     SearchContext &ctx, std::vector<PVLine> &lines) {
+	const std::vector<PVLine> &seed = *ctx.seed;
+	if (seed.size() < lineCount)
+		return 0;
+	for (size_t i = 0; i < lineCount; ++i) {
+		if (seed[i].moves.empty())
+			return 0;
+		const uint16_t move = packMove(seed[i].moves.front());
+		auto it = std::find_if(rootMoves.begin() + i, rootMoves.end(),
+		                       [&](const RootMove &rm) { return packMove(rm.move) == move; });
+		if (it == rootMoves.end())
+			return 0;
+		std::rotate(rootMoves.begin() + i, it, it + 1);
+	}
+
+	if (ctx.tt) {
+		TTEntry entry;
+		for (size_t i = 0; i < lineCount; ++i) {
+			size_t made = 0;
+			for (const Move &m : seed[i].moves) {
+				// Never replace what an earlier search, or another process, stored for it
+				if (!ctx.tt->probe(pos.key, entry))
+					ctx.tt->store(pos.key, 0, 0, BOUND_NONE, packMove(m));
+				if (!pos.makeMove(m))
+					break;
+				++made;
+			}
+			while (made--)
+				pos.undoMove();
+		}
+	}
+
+	lines.assign(seed.begin(), seed.begin() + lineCount);
+	return seed.front().depth;
+}
+
+bool searchMultiPV(Position &pos, int maxDepth, int multiPV, SearchContext &ctx,
+                   std::vector<PVLine> &lines, const PVReporter &report) {
 	std::vector<Move> moves;
 	GenerateLegalMoves(pos, moves);
 	if (moves.empty())
 		return false;
 
 	// Root move ordering: captures first
-	std::stable_sort(moves.begin(), moves.end(), [](const Move &a, const Move &b) {
-		bool ca = (a.flags & MF_CAPTURE) != 0;
-		bool cb = (b.flags & MF_CAPTURE) != 0;
-		return ca > cb;
-	});
+	orderMoves(moves);
 
-	bool timeUp = false;
-	bool foundAny = false;
-	Move currentBest{};
-	int currentBestScore = std::numeric_limits<int>::min();
+	std::vector<RootMove> rootMoves;
+	rootMoves.reserve(moves.size());
+	for (const Move &m : moves)
+		rootMoves.push_back(RootMove{m, -INF, -INF, {m}});
 
-	// Iterative deepening: 1..maxDepth
-	for (int depth = 1; depth <= maxDepth; ++depth) {
-		int alpha = std::numeric_limits<int>::min();
-		int beta = std::numeric_limits<int>::max();
+	const size_t lineCount =
+	    std::min(rootMoves.size(), static_cast<size_t>(std::clamp(multiPV, 1, MAX_MULTIPV)));
 
-		int bestScoreThisDepth = std::numeric_limits<int>::min();
-		Move bestMoveThisDepth{};
+	ctx.timeUp = false;
+	ctx.stats = SearchStats{};
+	if (ctx.tt)
+		ctx.tt->newSearch();
+	lines.clear();
+	ctx.rootPly = pos.stateStack.size();
+	ctx.startTime = std::chrono::steady_clock::now();
+	ctx.lastInfoTime = ctx.startTime - std::chrono::milliseconds(ctx.infoIntervalMs);
+	ctx.bestLine = PVLine{};
 
-		for (const Move &m : moves) {
-			if (!pos.makeMove(m))
-				continue;
+	PawnHashTable &pawnTable = threadPawnTable();
+	const u64 pawnProbesBefore = pawnTable.probes;
+	const u64 pawnHitsBefore = pawnTable.hits;
+	const Nnue::Stats nnueBefore = Nnue::threadStats();
 
-			int score = -alphaBeta(pos, depth - 1, -beta, -alpha, limits, timeUp);
+	const int seedDepth = ctx.seed ? applySeed(pos, rootMoves, lineCount, ctx, lines) : 0;
+	if (ctx.info && !lines.empty())
+		ctx.bestLine = lines.front();
 
-			pos.undoMove();
+	// Iterative deepening: 1..maxDepth
+	for (int depth = 1; depth <= maxDepth; ++depth) {
+		for (RootMove &rm : rootMoves)
+			rm.prevScore = rm.score;
 
-			if (timeUp) {
-				// Time's up while searching this depth -> discard this partial depth
-				// and fall back to the best move from the previous completed depth.
-				goto end_search;
+		for (size_t pvIdx = 0; pvIdx < lineCount; ++pvIdx) {
+			// Aspiration window around the score this slot had last iteration
+			int delta = ctx.params.aspirationWindow;
+			int alpha = -INF;
+			int beta = INF;
+			if (depth > 1) {
+				int prev = rootMoves[pvIdx].prevScore;
+				alpha = std::max(prev - delta, -INF);
+				beta = std::min(prev + delta, INF);
 			}
 
-			if (score > bestScoreThisDepth) {
-				bestScoreThisDepth = score;
-				bestMoveThisDepth = m;
-			}
-			if (score > alpha) {
-				alpha = score;
+			while (true) {
+				int score = searchRootMoves(pos, rootMoves, pvIdx, depth, alpha, beta, ctx);
+
+				if (ctx.timeUp) {
+					// Time's up while searching this depth -> discard this partial depth
+					// and fall back to the lines from the previous completed depth.
+					goto end_search;
+				}
+
+				if (score <= alpha && alpha > -INF) {
+					alpha = std::max(score - delta, -INF);
+				} else if (score >= beta && beta < INF) {
+					beta = std::min(score + delta, INF);
+				} else {
+					break;
+				}
+				delta *= 2;
 			}
+
+			// Best remaining move becomes this line; the others keep their relative order
+			std::stable_sort(rootMoves.begin() + pvIdx, rootMoves.end(),
+			                 [](const RootMove &a, const RootMove &b) { return a.score > b.score; });
 		}
 
-		// Completed this depth fully; update global best
-		currentBestScore = bestScoreThisDepth;
-		currentBest = bestMoveThisDepth;
-		foundAny = true;
+		// Completed this depth fully; publish the ranked lines unless the seed's are deeper
+		if (depth <= seedDepth)
+			continue;
+		lines.clear();
+		for (size_t i = 0; i < lineCount; ++i)
+			lines.push_back(PVLine{depth, rootMoves[i].score, rootMoves[i].pv});
 
-		// std::cout << "Depth " << depth << " best score = " << currentBestScore << std::endl;
+		if (report)
+			report(lines);
+		if (ctx.info) {
+			ctx.bestLine = lines.front();
+			reportInfo(ctx, std::chrono::steady_clock::now(), false);
+		}
 	}
 
 end_search:
-	if (!foundAny)
+	// The final counters are always reported
+	if (ctx.info)
+		reportInfo(ctx, std::chrono::steady_clock::now(), true);
+	ctx.stats.pawnProbes = pawnTable.probes - pawnProbesBefore;
+	ctx.stats.pawnHits = pawnTable.hits - pawnHitsBefore;
+	ctx.stats.nnueEvals = Nnue::threadStats().evals - nnueBefore.evals;
+	ctx.stats.nnueRefreshes = Nnue::threadStats().refreshes - nnueBefore.refreshes;
+	if (ctx.tt)
+		ctx.tt->recordProbes(ctx.stats.ttProbes, ctx.stats.ttHits);
+	return !lines.empty();
+}
+
+bool searchBestMove(Position &pos, int maxDepth, SearchContext &ctx, Move &bestMove) {
+	std::vector<PVLine> lines;
+	if (!searchMultiPV(pos, maxDepth, 1, ctx, lines))
 		return false;
-	bestMove = currentBest;
+	bestMove = lines.front().moves.front();
 	return true;
 }
@@ -2,18 +2,156 @@
 
 #include "move.h"
 #include "position.h"
+#include "tt.h"
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <vector>
 
 struct SearchLimits {
 	bool useTime = false;
 	std::chrono::steady_clock::time_point endTime;
+	u64 maxNodes = 0; // 0 for no node limit
+	// Flags owned by another thread, read with the clock: stop ends the search and the clock
+	// is ignored while ponder is set
+	const std::atomic<bool> *stop = nullptr;
+	const std::atomic<bool> *ponder = nullptr;
 };
 
-int evaluateMaterial(const Position &pos);
+// Tunable search constants.
+//  - Quiescence skips captures whose victim plus deltaMargin cannot reach alpha.
+//  - Quiet moves after the first lmrMinMoves, at depth >= lmrMinDepth, are reduced by
+//    lmrBase / 100 + ln(depth) * ln(moveNumber) / (lmrDivisor / 100) plies.
+//  - A move gets remaining / timeMovesToGo of the clock plus timeIncPercent of the increment.
+struct SearchParams {
+	int aspirationWindow = 50;
+	int deltaMargin = 200;
+	int lmrMinDepth = 3;
+	int lmrMinMoves = 4;
+	int lmrBase = 75;
+	int lmrDivisor = 225;
+	int timeMovesToGo = 30;
+	int timeIncPercent = 75;
+};
+
+// One tunable SearchParams field with its legal range and SPSA perturbation size
+struct SearchParamSpec {
+	const char *name;
+	int SearchParams::*field;
+	int min;
+	int max;
+	double step;
+};
+
+extern const std::vector<SearchParamSpec> SearchParamSpecs;
+
+// Think time for one move from the remaining clock and increment, in milliseconds
+int allocateTime(const SearchParams &params, int remainingMs, int incMs);
+
+// Counters collected over one search
+struct SearchStats {
+	u64 nodes = 0;
+	int seldepth = 0; // deepest ply reached, quiescence included
+	u64 pawnProbes = 0;
+	u64 pawnHits = 0;
+	u64 evalProbes = 0;
+	u64 evalHits = 0;
+	u64 ttProbes = 0;
+	u64 ttHits = 0;
+	u64 nnueEvals = 0;
+	u64 nnueRefreshes = 0;
+
+	double pawnHitRate() const {
+		return pawnProbes ? static_cast<double>(pawnHits) / pawnProbes : 0.0;
+	}
+	double evalHitRate() const {
+		return evalProbes ? static_cast<double>(evalHits) / evalProbes : 0.0;
+	}
+	double ttHitRate() const { return ttProbes ? static_cast<double>(ttHits) / ttProbes : 0.0; }
+	// Accumulator refreshes per side per evaluation (0 when fully incremental)
+	double nnueRefreshRate() const {
+		return nnueEvals ? static_cast<double>(nnueRefreshes) / (2.0 * nnueEvals) : 0.0;
+	}
+};
+
+// One ranked root line: the principal variation starting with a root move
+struct PVLine {
+	int depth = 0;
+	int score = 0;
+	std::vector<Move> moves;
+};
+
+// Progress of a running search: the best line of the last completed depth with the counters so
+// far
+struct SearchInfo {
+	int depth = 0;
+	int seldepth = 0;
+	int score = 0;
+	u64 nodes = 0;
+	int timeMs = 0;
+	u64 nps = 0;
+	int hashfull = 0; // per mille, 0 without a transposition table
+	std::vector<Move> pv;
+};
+
+using InfoReporter = std::function<void(const SearchInfo &info)>;
 
-// Negamax alpha–beta with time limit support
-int alphaBeta(Position &pos, int depth, int alpha, int beta, const SearchLimits &limits,
-              bool &timeUp);
+// Per-search state threaded through alphaBeta. The tables are owned by the caller and may be
+// left null to search without them.
+struct SearchContext {
+	SearchLimits limits;
+	SearchParams params;
+	bool timeUp = false;
+	SearchStats stats;
+	TranspositionTable *tt = nullptr;
+	EvalCache *evalCache = nullptr;
+
+	// Lines of an earlier, shallower search of this position: their moves are hash-move hints
+	// and they stand as the result until iterative deepening gets past their depth
+	const std::vector<PVLine> *seed = nullptr;
+
+	// Called on the search thread at most once per infoIntervalMs, after a completed depth or
+	// from the periodic clock check, and once more when the search ends
+	InfoReporter info;
+	int infoIntervalMs = 100;
+
+	// Set by the root search
+	size_t rootPly = 0;
+	std::chrono::steady_clock::time_point startTime;
+	std::chrono::steady_clock::time_point lastInfoTime;
+	PVLine bestLine;
+};
+
+// Called after every completed iteration with the lines ranked best first
+using PVReporter = std::function<void(const std::vector<PVLine> &lines)>;
+
+static constexpr int MAX_MULTIPV = 8;
+
+// The side to move checkmated ply plies from the root scores -MATE_SCORE + ply, so shorter
+// mates score higher. Scores beyond MATE_IN_MAX either way are mates.
+static constexpr int MATE_SCORE = 100000;
+static constexpr int MATE_IN_MAX = MATE_SCORE - 1000;
+
+inline bool isMateScore(int score) { return score >= MATE_IN_MAX || score <= -MATE_IN_MAX; }
+
+// Full moves to the mate of a mate score, negative when the side to move is mated
+inline int mateInMoves(int score) {
+	return score > 0 ? (MATE_SCORE - score + 1) / 2 : -(MATE_SCORE + score) / 2;
+}
+
+// Negamax alpha–beta with time limit support, fills pv with the best line found
+int alphaBeta(Position &pos, int depth, int alpha, int beta, SearchContext &ctx,
+              std::vector<Move> &pv);
+
+// Captures-only search from a stand-pat static evaluation to reach a quiet position. If pv is
+// given it receives the capture sequence leading to that position.
+int quiescence(Position &pos, int alpha, int beta, SearchContext &ctx,
+               std::vector<Move> *pv = nullptr);
 
 // Iterative deepening root search with time limits
-bool searchBestMove(Position &pos, int maxDepth, const SearchLimits &limits, Move &bestMove);
+bool searchBestMove(Position &pos, int maxDepth, SearchContext &ctx, Move &bestMove);
+
+// Iterative deepening that ranks the best multiPV root moves. Each line is searched in an
+// aspiration window around its previous score with the lines already found excluded.
+bool searchMultiPV(Position &pos, int maxDepth, int multiPV, SearchContext &ctx,
+                   std::vector<PVLine> &lines, const PVReporter &report = nullptr);
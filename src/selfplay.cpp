@@ -0,0 +1,146 @@
+#include "selfplay.h"
+#include "epd_reader.h"
+#include "mapped_file.h"
+#include "movegen.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+namespace {
+
+// Node-limited games deepen until the node budget runs out
+constexpr int NODE_LIMITED_DEPTH = 64;
+
+struct Player {
+	const EngineConfig &config;
+	TranspositionTable tt;
+	EvalCache evalCache;
+	int clockMs;
+
+	Player(const EngineConfig &cfg, int timeMs)
+	    : config(cfg), tt(cfg.hashMb), evalCache(cfg.evalCacheMb),
+	      clockMs(timeMs) {}
+};
+
+} // namespace
+
+GameOutcome playGame(const Position &start, const EngineConfig &white, const EngineConfig &black,
+                     const GameLimits &limits, const MoveObserver &observer) {
+	Position pos = start;
+	Player players[2] = {Player(white, limits.timeMs), Player(black, limits.timeMs)};
+	std::vector<Move> moves;
+	std::vector<PVLine> lines;
+	int whiteAhead = 0, blackAhead = 0, level = 0; // consecutive plies for adjudication
+
+	for (int ply = 0;; ++ply) {
+		GenerateLegalMoves(pos, moves);
+		if (moves.empty()) {
+			if (!pos.inCheck(pos.sideToMove))
+				return GameOutcome::DRAW;
+			return pos.sideToMove == WHITE ? GameOutcome::BLACK_WIN : GameOutcome::WHITE_WIN;
+		}
+		if (pos.isFiftyMoveDraw() || ply >= limits.maxPlies || pos.isInsufficientMaterial() ||
+		    pos.isRepetition())
+			return GameOutcome::DRAW;
+
+		Player &player = players[pos.sideToMove];
+		SearchContext ctx;
+		ctx.params = player.config.search;
+		ctx.tt = &player.tt;
+		ctx.evalCache = player.evalCache.enabled() ? &player.evalCache : nullptr;
+
+		int maxDepth = player.config.maxDepth;
+		auto begin = std::chrono::steady_clock::now();
+		if (limits.nodes > 0) {
+			ctx.limits.maxNodes = limits.nodes;
+			maxDepth = NODE_LIMITED_DEPTH;
+		} else {
+			int thinkMs = allocateTime(ctx.params, player.clockMs, limits.incMs);
+			ctx.limits.useTime = true;
+			ctx.limits.endTime = begin + std::chrono::milliseconds(thinkMs);
+		}
+
+		searchMultiPV(pos, maxDepth, 1, ctx, lines);
+
+		if (limits.nodes == 0) {
+			auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+			    std::chrono::steady_clock::now() - begin);
+			player.clockMs -= static_cast<int>(elapsed.count());
+			if (player.clockMs < 0)
+				return pos.sideToMove == WHITE ? GameOutcome::BLACK_WIN : GameOutcome::WHITE_WIN;
+			player.clockMs += limits.incMs;
+		}
+
+		// A search stopped before finishing depth 1 has no line; any legal move will do
+		const Move move = lines.empty() ? moves.front() : lines.front().moves.front();
+		const int score = lines.empty() ? 0 : lines.front().score;
+		if (observer)
+			observer(pos, move, score);
+
+		const int whiteScore = pos.sideToMove == WHITE ? score : -score;
+		whiteAhead = whiteScore >= limits.winScore ? whiteAhead + 1 : 0;
+		blackAhead = -whiteScore >= limits.winScore ? blackAhead + 1 : 0;
+		level = std::abs(whiteScore) <= limits.drawScore ? level + 1 : 0;
+		if (limits.winPlies > 0 && whiteAhead >= limits.winPlies)
+			return GameOutcome::WHITE_WIN;
+		if (limits.winPlies > 0 && blackAhead >= limits.winPlies)
+			return GameOutcome::BLACK_WIN;
+		if (limits.drawPlies > 0 && ply >= limits.drawMinPly && level >= limits.drawPlies)
+			return GameOutcome::DRAW;
+
+		pos.makeMove(move);
+	}
+}
+
+Position randomOpening(std::mt19937_64 &rng, int plies) {
+	std::vector<Move> moves;
+	while (true) {
+		Position pos;
+		pos.setStartPosition();
+		bool ok = true;
+		for (int i = 0; i < plies && ok; ++i) {
+			GenerateLegalMoves(pos, moves);
+			if (moves.empty())
+				ok = false;
+			else
+				pos.makeMove(moves[rng() % moves.size()]);
+		}
+		GenerateLegalMoves(pos, moves);
+		if (ok && !moves.empty()) {
+			// Drop the undo history so the opening behaves like a fresh position
+			Position fresh;
+			fresh.setFromFEN(pos.toFEN());
+			return fresh;
+		}
+	}
+}
+
+std::vector<std::string> loadOpenings(const std::string &path) {
+	std::vector<std::string> fens;
+	MappedFile file;
+	if (!file.open(path))
+		return fens;
+	Position pos;
+	forEachLine(std::string_view(file.data(), file.size()), [&](std::string_view line) {
+		if (pos.setFromFEN(line))
+			fens.emplace_back(line);
+	});
+	return fens;
+}
+
+void parallelFor(int threads, size_t count, const std::function<void(size_t)> &job) {
+	std::atomic<size_t> next{0};
+	auto worker = [&]() {
+		for (size_t i = next++; i < count; i = next++)
+			job(i);
+	};
+
+	std::vector<std::thread> pool;
+	for (int t = 1; t < threads; ++t)
+		pool.emplace_back(worker);
+	worker();
+	for (auto &th : pool)
+		th.join();
+}
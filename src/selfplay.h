@@ -0,0 +1,47 @@
+#pragma once
+#include "engine_session.h"
+#include <functional>
+#include <random>
+#include <string>
+
+// Engine-vs-engine games inside one process, used by the tuners and the match runner.
+
+// Per-move search limits for both sides. With nodes > 0 every move searches that many nodes;
+// otherwise each side has a clock of timeMs plus incMs per move.
+struct GameLimits {
+	u64 nodes = 0;
+	int timeMs = 10000;
+	int incMs = 100;
+	int maxPlies = 400; // adjudicated as a draw after this many plies
+
+	// Score adjudication, a 0 plies count disables it. A game is won once winPlies consecutive
+	// search scores favour the same side by at least winScore, and drawn once drawPlies
+	// consecutive scores stay within drawScore after drawMinPly.
+	int winScore = 1000;
+	int winPlies = 8;
+	int drawScore = 10;
+	int drawPlies = 16;
+	int drawMinPly = 80;
+};
+
+enum class GameOutcome { WHITE_WIN, BLACK_WIN, DRAW };
+
+// Called after every search with the position before the move, the move and its score from
+// the side to move's point of view
+using MoveObserver = std::function<void(const Position &pos, const Move &move, int score)>;
+
+// Play one game from start. Each side gets its own transposition table sized by its config.
+// Checkmate, stalemate, threefold repetition, the fifty-move rule, bare kings, adjudication and
+// the ply cap end the game; a side whose clock runs out loses.
+GameOutcome playGame(const Position &start, const EngineConfig &white, const EngineConfig &black,
+                     const GameLimits &limits, const MoveObserver &observer = nullptr);
+
+// Start position followed by plies random legal moves; retried until the side to move still
+// has a legal move at the end
+Position randomOpening(std::mt19937_64 &rng, int plies);
+
+// FEN/EPD lines of an opening suite that parse as positions
+std::vector<std::string> loadOpenings(const std::string &path);
+
+// Run job(i) for every i in [0, count) on threads worker threads, handing out indices in order
+void parallelFor(int threads, size_t count, const std::function<void(size_t)> &job);
@@ -0,0 +1,375 @@
+#include "server.h"
+#include "framing.h"
+#include "protocol.h"
+#include "result_cache.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Write side of a client; responses from several workers are serialized per connection
+class Connection {
+  public:
+	Connection(int fd, bool owned) : fd(fd), owned(owned) {}
+	~Connection() {
+		if (owned)
+			::close(fd);
+	}
+
+	void send(const json &message) {
+		std::lock_guard<std::mutex> lock(mutex);
+		writeAll(fd, encodeMessage(message, format)); // a failed write means the client is gone
+	}
+
+	WireFormat wireFormat() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return format;
+	}
+
+	void setWireFormat(WireFormat f) {
+		std::lock_guard<std::mutex> lock(mutex);
+		format = f;
+	}
+
+  private:
+	int fd;
+	bool owned;
+	std::mutex mutex;
+	WireFormat format = WireFormat::JSON_LINES;
+};
+
+json resultCacheJson() {
+	const ResultCache::Stats st = resultCache().stats();
+	return json{{"entries", st.entries}, {"memory_bytes", st.bytes},
+	            {"memory_limit_bytes", st.capacity}, {"probes", st.probes},
+	            {"hits", st.hits}, {"seeds", st.seeds}};
+}
+
+class Server {
+  public:
+	explicit Server(const ServerOptions &opts) : opts(opts) {
+		const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+		const int threads = opts.threads > 0 ? opts.threads : std::max(1, hardware);
+		for (int t = 0; t < threads; ++t)
+			workers.emplace_back([this] { work(); });
+		janitor = std::thread([this] { sweep(); });
+	}
+
+	~Server() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		jobReady.notify_all();
+		stopped.notify_all();
+		for (auto &th : workers)
+			th.join();
+		janitor.join();
+	}
+
+	void submit(const std::shared_ptr<Connection> &conn, json req) {
+		if (!req.is_object()) {
+			conn->send(protocolError("request must be an object"));
+			return;
+		}
+
+		const std::string cmd = req.value("cmd", "");
+		if (cmd == "server-stats") {
+			json out = stats();
+			tagResponse(out, req);
+			conn->send(out);
+			return;
+		}
+		const auto game = req.find("game");
+		if (game == req.end() || !game->is_string() || game->get<std::string>().empty()) {
+			json out = protocolError("missing game id");
+			tagResponse(out, req);
+			conn->send(out);
+			return;
+		}
+		const std::string id = game->get<std::string>();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		evictLocked(Clock::now());
+		auto it = slots.find(id);
+		if (it == slots.end()) {
+			if (cmd != "new-game") {
+				json out = protocolError("unknown game");
+				out["game"] = id;
+				tagResponse(out, req);
+				conn->send(out);
+				return;
+			}
+			it = slots.emplace(id, std::make_shared<Slot>()).first;
+			it->second->id = id;
+			it->second->lastUsed = Clock::now();
+		}
+		const std::shared_ptr<Slot> &slot = it->second;
+		slot->pending.push_back({conn, std::move(req)});
+		if (!slot->busy) {
+			slot->busy = true;
+			++busyCount;
+			ready.push_back(slot);
+			jobReady.notify_one();
+		}
+	}
+
+	// Wait for every submitted request to be answered
+	void drain() {
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [&] { return busyCount == 0; });
+	}
+
+  private:
+	struct Job {
+		std::shared_ptr<Connection> conn;
+		json req;
+	};
+
+	// One game. Only the worker that set busy touches session until it clears busy again.
+	struct Slot {
+		std::string id;
+		std::unique_ptr<EngineSession> session;
+		std::deque<Job> pending;
+		bool busy = false;
+		bool closed = false;
+		Clock::time_point lastUsed;
+		size_t bytes = 0;
+	};
+
+	const ServerOptions opts;
+	std::mutex mutex;
+	std::condition_variable jobReady, idle, stopped;
+	std::unordered_map<std::string, std::shared_ptr<Slot>> slots;
+	std::deque<std::shared_ptr<Slot>> ready; // busy slots waiting for a worker
+	size_t busyCount = 0;
+	size_t totalBytes = 0;
+	size_t evicted = 0;
+	bool stopping = false;
+	std::vector<std::thread> workers;
+	std::thread janitor;
+
+	void work() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			jobReady.wait(lock, [&] { return !ready.empty() || stopping; });
+			if (ready.empty())
+				return;
+			std::shared_ptr<Slot> slot = std::move(ready.front());
+			ready.pop_front();
+
+			// Run the game's requests in order until its queue is empty
+			while (!slot->pending.empty()) {
+				Job job = std::move(slot->pending.front());
+				slot->pending.pop_front();
+				lock.unlock();
+
+				auto emit = [&](json event) {
+					event["game"] = slot->id;
+					tagResponse(event, job.req);
+					job.conn->send(event);
+				};
+				json out = run(*slot, job.req, emit);
+				out["game"] = slot->id;
+				tagResponse(out, job.req);
+				const size_t bytes = slot->session ? slot->session->memoryUsage() : 0;
+
+				// Account before answering so a following server-stats sees this request
+				lock.lock();
+				slot->lastUsed = Clock::now();
+				totalBytes = totalBytes - slot->bytes + bytes;
+				slot->bytes = bytes;
+				lock.unlock();
+				job.conn->send(out);
+				lock.lock();
+			}
+			slot->busy = false;
+			--busyCount;
+			if (slot->closed)
+				removeLocked(slot->id);
+			idle.notify_all();
+		}
+	}
+
+	json run(Slot &slot, const json &req, const ProtocolEmitter &emit) {
+		const std::string cmd = req.value("cmd", "");
+		if (cmd == "close") {
+			slot.closed = true;
+			slot.session.reset();
+			return json{{"event", "closed"}};
+		}
+		// Requests queued behind a close see the game as gone until it is started again
+		if (slot.closed && cmd != "new-game")
+			return protocolError("unknown game");
+		slot.closed = false;
+		if (!slot.session)
+			slot.session = std::make_unique<EngineSession>(opts.config);
+		try {
+			return handleProtocolRequest(*slot.session, req, emit);
+		} catch (const std::exception &e) {
+			return protocolError(e.what());
+		}
+	}
+
+	void removeLocked(const std::string &id) {
+		auto it = slots.find(id);
+		if (it == slots.end())
+			return;
+		totalBytes -= it->second->bytes;
+		slots.erase(it);
+	}
+
+	// Drop sessions idle for too long, then the least recently used idle ones while over the
+	// memory limit. Sessions with queued or running requests are never evicted.
+	void evictLocked(Clock::time_point now) {
+		const auto maxIdle = std::chrono::seconds(opts.idleSeconds);
+		for (auto it = slots.begin(); it != slots.end();) {
+			const Slot &slot = *it->second;
+			if (!slot.busy && now - slot.lastUsed > maxIdle) {
+				totalBytes -= slot.bytes;
+				it = slots.erase(it);
+				++evicted;
+			} else {
+				++it;
+			}
+		}
+
+		const size_t limit = opts.memoryLimitMb * 1024 * 1024;
+		while (totalBytes > limit) {
+			auto lru = slots.end();
+			for (auto it = slots.begin(); it != slots.end(); ++it)
+				if (!it->second->busy &&
+				    (lru == slots.end() || it->second->lastUsed < lru->second->lastUsed))
+					lru = it;
+			if (lru == slots.end())
+				break;
+			totalBytes -= lru->second->bytes;
+			slots.erase(lru);
+			++evicted;
+		}
+	}
+
+	void sweep() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!stopped.wait_for(lock, std::chrono::seconds(1), [&] { return stopping; }))
+			evictLocked(Clock::now());
+	}
+
+	json stats() {
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto now = Clock::now();
+		json games = json::array();
+		for (const auto &[id, slot] : slots) {
+			const double idleSecs = std::chrono::duration<double>(now - slot->lastUsed).count();
+			games.push_back({{"game", id},
+			                 {"memory_bytes", slot->bytes},
+			                 {"busy", slot->busy},
+			                 {"idle_seconds", slot->busy ? 0.0 : idleSecs}});
+		}
+		return json{{"event", "server-stats"},
+		            {"sessions", slots.size()},
+		            {"workers", workers.size()},
+		            {"memory_bytes", totalBytes},
+		            {"memory_limit_bytes", opts.memoryLimitMb * 1024 * 1024},
+		            {"evicted", evicted},
+		            {"result_cache", resultCacheJson()},
+		            {"games", games}};
+	}
+};
+
+// Read requests from fd until end of input, negotiating the framing on the first one
+void serveConnection(Server &server, int fd, const std::shared_ptr<Connection> &conn) {
+	MessageReader reader(fd);
+	json req;
+	for (bool first = true;; first = false) {
+		MessageReader::Result result = reader.next(conn->wireFormat(), req);
+		if (result == MessageReader::END)
+			return;
+		if (result == MessageReader::INVALID) {
+			conn->send(protocolError("invalid json"));
+			continue;
+		}
+		json reply;
+		WireFormat format = conn->wireFormat();
+		if (first && negotiateWireFormat(req, format, reply)) {
+			conn->send(reply);
+			conn->setWireFormat(format);
+			continue;
+		}
+		server.submit(conn, std::move(req));
+	}
+}
+
+int listenUnix(const std::string &path) {
+	sockaddr_un addr{};
+	if (path.size() >= sizeof(addr.sun_path))
+		return -1;
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	addr.sun_family = AF_UNIX;
+	path.copy(addr.sun_path, path.size());
+	::unlink(path.c_str());
+	if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+	    ::listen(fd, SOMAXCONN) != 0) {
+		::close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+} // namespace
+
+void serveStream(const ServerOptions &opts, int inFd, int outFd) {
+	Server server(opts);
+	serveConnection(server, inFd, std::make_shared<Connection>(outFd, false));
+	server.drain();
+}
+
+int runServer(const ServerOptions &opts) {
+	// A client that disconnects must not kill the server on the next write
+	std::signal(SIGPIPE, SIG_IGN);
+	resultCache().setCapacity(opts.resultCacheMb * 1024 * 1024);
+	if (opts.socketPath.empty()) {
+		serveStream(opts, STDIN_FILENO, STDOUT_FILENO);
+		return 0;
+	}
+
+	Server server(opts);
+
+	int listener = listenUnix(opts.socketPath);
+	if (listener < 0) {
+		std::cerr << "Cannot listen on " << opts.socketPath << "\n";
+		return 1;
+	}
+	std::cerr << "Listening on " << opts.socketPath << "\n";
+	while (true) {
+		int client = ::accept(listener, nullptr, nullptr);
+		if (client < 0) {
+			// Out of descriptors or buffers: give closing connections and the janitor time to
+			// free some instead of spinning on the same error
+			if (errno != EINTR && errno != ECONNABORTED)
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			continue;
+		}
+		std::thread([&server, client] {
+			serveConnection(server, client, std::make_shared<Connection>(client, true));
+		}).detach();
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "engine_session.h"
+#include <cstddef>
+#include <string>
+
+struct ServerOptions {
+	std::string socketPath; // Unix-domain socket to listen on; standard input/output when empty
+	int threads = 0;        // search workers, 0 uses every hardware thread
+	EngineConfig config;    // for every new session
+	size_t memoryLimitMb = 1024; // least recently used idle sessions are evicted above this
+	int idleSeconds = 1800;      // sessions idle for longer are evicted
+	size_t resultCacheMb = 0;    // finished searches shared between games, 0 disables
+};
+
+// Host many games in one process. Requests are protocol.h requests with a "game" id; each id
+// owns an EngineSession created by its first "new-game". Requests for one game run in order,
+// different games run concurrently on a fixed pool of workers, and every response carries the
+// game id of its request. Two extra commands need no session: {"cmd": "close", "game": id}
+// drops one and {"cmd": "server-stats"} reports sessions, memory and the result cache. Returns
+// a process exit code.
+int runServer(const ServerOptions &opts);
+
+// Serve a single client that writes requests to inFd and reads responses from outFd, returning
+// once its input ends and every request has been answered. Neither descriptor is closed.
+void serveStream(const ServerOptions &opts, int inFd, int outFd);
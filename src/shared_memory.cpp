@@ -0,0 +1,80 @@
+#include "shared_memory.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+SharedMemory::~SharedMemory() { close(); }
+
+SharedMemory::SharedMemory(SharedMemory &&other) noexcept
+    : base(std::exchange(other.base, nullptr)), length(std::exchange(other.length, 0)) {}
+
+SharedMemory &SharedMemory::operator=(SharedMemory &&other) noexcept {
+	if (this != &other) {
+		close();
+		base = std::exchange(other.base, nullptr);
+		length = std::exchange(other.length, 0);
+	}
+	return *this;
+}
+
+static bool fail(std::string *error, const std::string &what) {
+	if (error)
+		*error = what + ": " + std::strerror(errno);
+	return false;
+}
+
+bool SharedMemory::open(const std::string &name, size_t size, bool &created, std::string *error) {
+	close();
+	const std::string path = name.empty() || name[0] != '/' ? "/" + name : name;
+
+	// Exactly one process creates and sizes the segment; the rest wait for it to be sized
+	int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	created = fd >= 0;
+	if (created) {
+		if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+			fail(error, "ftruncate " + path);
+			::close(fd);
+			shm_unlink(path.c_str());
+			return false;
+		}
+	} else {
+		if (errno != EEXIST)
+			return fail(error, "shm_open " + path);
+		fd = shm_open(path.c_str(), O_RDWR, 0);
+		if (fd < 0)
+			return fail(error, "shm_open " + path);
+	}
+
+	struct stat st {};
+	for (int tries = 0; fstat(fd, &st) == 0 && st.st_size == 0 && tries < 100; ++tries)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	if (st.st_size <= 0) {
+		errno = EINVAL;
+		::close(fd);
+		return fail(error, "empty segment " + path);
+	}
+
+	length = static_cast<size_t>(st.st_size);
+	void *p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd); // the mapping keeps the segment referenced
+	if (p == MAP_FAILED) {
+		length = 0;
+		return fail(error, "mmap " + path);
+	}
+	base = p;
+	return true;
+}
+
+void SharedMemory::close() {
+	if (base) {
+		munmap(base, length);
+		base = nullptr;
+		length = 0;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-write mapping of a named POSIX shared-memory segment ("/name", see shm_open(3)) that
+// other processes can map too. The segment outlives the processes using it until it is
+// removed, e.g. with rm /dev/shm/name on Linux. Move-only; unmapped on destruction.
+class SharedMemory {
+  public:
+	SharedMemory() = default;
+	~SharedMemory();
+
+	SharedMemory(const SharedMemory &) = delete;
+	SharedMemory &operator=(const SharedMemory &) = delete;
+	SharedMemory(SharedMemory &&other) noexcept;
+	SharedMemory &operator=(SharedMemory &&other) noexcept;
+
+	// Map the segment, creating it zero-filled with size bytes if it does not exist yet, in
+	// which case created is set. An existing segment is mapped at whatever size it has.
+	bool open(const std::string &name, size_t size, bool &created, std::string *error = nullptr);
+	void close();
+
+	bool isOpen() const { return base != nullptr; }
+	void *data() const { return base; }
+	size_t size() const { return length; }
+
+  private:
+	void *base = nullptr;
+	size_t length = 0;
+};
@@ -0,0 +1,174 @@
+#include "spsa.h"
+#include "search.h"
+#include "selfplay.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// Standard SPSA gain sequence exponents
+constexpr double ALPHA = 0.602;
+constexpr double GAMMA = 0.101;
+
+constexpr int RANDOM_OPENING_PLIES = 8;
+
+std::vector<double> defaultTheta() {
+	const SearchParams defaults;
+	std::vector<double> theta;
+	for (const SearchParamSpec &spec : SearchParamSpecs)
+		theta.push_back(defaults.*spec.field);
+	return theta;
+}
+
+SearchParams toParams(const std::vector<double> &theta) {
+	SearchParams params;
+	for (size_t i = 0; i < SearchParamSpecs.size(); ++i) {
+		const SearchParamSpec &spec = SearchParamSpecs[i];
+		int value = static_cast<int>(std::lround(theta[i]));
+		params.*spec.field = std::clamp(value, spec.min, spec.max);
+	}
+	return params;
+}
+
+// Log lines look like "iter 12 plus 5 minus 3 draws 8 aspiration_window=50.21 ..."; the last
+// one holds the parameters to resume from
+bool readLog(const std::string &path, int &iteration, std::vector<double> &theta) {
+	std::ifstream in(path);
+	std::string line, last;
+	while (std::getline(in, line))
+		if (line.rfind("iter ", 0) == 0)
+			last = line;
+	if (last.empty())
+		return false;
+
+	std::istringstream ss(last);
+	std::string token;
+	ss >> token >> iteration;
+	while (ss >> token) {
+		size_t eq = token.find('=');
+		if (eq == std::string::npos)
+			continue;
+		std::string name = token.substr(0, eq);
+		for (size_t i = 0; i < SearchParamSpecs.size(); ++i)
+			if (name == SearchParamSpecs[i].name)
+				theta[i] = std::stod(token.substr(eq + 1));
+	}
+	return true;
+}
+
+} // namespace
+
+int runSpsa(const SpsaOptions &opts) {
+	std::vector<std::string> openings;
+	if (!opts.openingsPath.empty()) {
+		openings = loadOpenings(opts.openingsPath);
+		if (openings.empty()) {
+			std::cerr << "No usable openings in " << opts.openingsPath << "\n";
+			return 1;
+		}
+	}
+
+	std::vector<double> theta = defaultTheta();
+	int done = 0;
+	if (readLog(opts.logPath, done, theta))
+		std::cout << "Resuming " << opts.logPath << " after iteration " << done << "\n";
+
+	std::ofstream log(opts.logPath, std::ios::app);
+	if (!log) {
+		std::cerr << "Cannot write " << opts.logPath << "\n";
+		return 1;
+	}
+
+	const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+	const int threads = opts.threads > 0 ? opts.threads : std::max(1, hardware);
+	const size_t params = SearchParamSpecs.size();
+	const int games = 2 * std::max(1, opts.pairsPerIteration);
+
+	// Perturbation c_k = c / k^GAMMA ends at each parameter's step; gain a_k = a / (A + k)^ALPHA
+	// ends at rate * step^2
+	const double stability = 0.1 * opts.iterations;
+	std::vector<double> c(params), a(params);
+	for (size_t i = 0; i < params; ++i) {
+		double step = SearchParamSpecs[i].step;
+		c[i] = step * std::pow(opts.iterations, GAMMA);
+		a[i] = opts.rate * step * step * std::pow(stability + opts.iterations, ALPHA);
+	}
+
+	EngineConfig base;
+	base.hashMb = 2;
+	GameLimits limits;
+	limits.nodes = opts.nodes;
+
+	for (int k = done + 1; k <= opts.iterations; ++k) {
+		auto start = std::chrono::steady_clock::now();
+		std::mt19937_64 rng(opts.seed * 1000003ULL + k);
+
+		std::vector<double> ck(params), delta(params), plus(theta), minus(theta);
+		for (size_t i = 0; i < params; ++i) {
+			ck[i] = c[i] / std::pow(k, GAMMA);
+			delta[i] = (rng() & 1) ? 1.0 : -1.0;
+			plus[i] += ck[i] * delta[i];
+			minus[i] -= ck[i] * delta[i];
+		}
+		EngineConfig plusCfg = base, minusCfg = base;
+		plusCfg.search = toParams(plus);
+		minusCfg.search = toParams(minus);
+
+		std::vector<Position> starts;
+		for (int p = 0; p < games / 2; ++p) {
+			Position pos;
+			if (openings.empty())
+				pos = randomOpening(rng, RANDOM_OPENING_PLIES);
+			else
+				pos.setFromFEN(openings[rng() % openings.size()]);
+			starts.push_back(pos);
+		}
+
+		// Game g plays opening g / 2, with the plus variant as White on even g
+		std::vector<int> plusScore(games);
+		parallelFor(threads, games, [&](size_t g) {
+			const bool plusWhite = g % 2 == 0;
+			GameOutcome outcome = playGame(starts[g / 2], plusWhite ? plusCfg : minusCfg,
+			                               plusWhite ? minusCfg : plusCfg, limits);
+			int white = outcome == GameOutcome::WHITE_WIN   ? 1
+			            : outcome == GameOutcome::BLACK_WIN ? -1
+			                                                : 0;
+			plusScore[g] = plusWhite ? white : -white;
+		});
+
+		int wins = 0, losses = 0;
+		for (int s : plusScore) {
+			wins += s > 0;
+			losses += s < 0;
+		}
+		const int result = wins - losses;
+		for (size_t i = 0; i < params; ++i) {
+			const double ak = a[i] / std::pow(stability + k, ALPHA);
+			theta[i] += ak / ck[i] * result * delta[i];
+			theta[i] = std::clamp(theta[i], double(SearchParamSpecs[i].min),
+			                      double(SearchParamSpecs[i].max));
+		}
+
+		std::ostringstream line;
+		line << "iter " << k << " plus " << wins << " minus " << losses << " draws "
+		     << games - wins - losses;
+		for (size_t i = 0; i < params; ++i) {
+			char value[32];
+			std::snprintf(value, sizeof(value), "%.3f", theta[i]);
+			line << " " << SearchParamSpecs[i].name << "=" << value;
+		}
+		log << line.str() << std::endl;
+
+		double secs =
+		    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::printf("%s  (%.1fs)\n", line.str().c_str(), secs);
+		std::fflush(stdout);
+	}
+	return 0;
+}
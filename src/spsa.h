@@ -0,0 +1,19 @@
+#pragma once
+#include "types.h"
+#include <string>
+
+struct SpsaOptions {
+	std::string logPath;      // appended every iteration; an existing log is resumed
+	std::string openingsPath; // EPD/FEN openings, random openings when empty
+	int iterations = 1000;
+	int pairsPerIteration = 8; // each pair plays one opening with both colours
+	u64 nodes = 5000;          // per move
+	int threads = 0;           // 0 uses every hardware thread
+	double rate = 0.002;       // final step divided by the squared perturbation
+	unsigned seed = 1;
+};
+
+// SPSA over SearchParamSpecs: each iteration perturbs every parameter by +/- its step, plays the
+// plus against the minus variant and moves the parameters towards the better one. Returns a
+// process exit code.
+int runSpsa(const SpsaOptions &opts);
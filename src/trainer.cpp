@@ -0,0 +1,478 @@
+#include "trainer.h"
+#include "game_chain.h"
+#include "mapped_file.h"
+#include "nnue.h"
+#include "training_data.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TRAINER_X86 1
+#endif
+
+namespace {
+
+using Nnue::INPUTS;
+using Nnue::L1;
+using Nnue::L2;
+
+// All parameters live in one flat vector so gradients and optimizer state share its layout
+constexpr size_t FT_WEIGHTS = 0;
+constexpr size_t FT_BIAS = FT_WEIGHTS + static_cast<size_t>(INPUTS) * L1;
+constexpr size_t L1_WEIGHTS = FT_BIAS + L1;
+constexpr size_t L1_BIAS = L1_WEIGHTS + static_cast<size_t>(L2) * 2 * L1;
+constexpr size_t OUT_WEIGHTS = L1_BIAS + L2;
+constexpr size_t OUT_BIAS = OUT_WEIGHTS + L2;
+constexpr size_t PARAM_COUNT = OUT_BIAS + 1;
+
+constexpr int MAX_FEATURES = 32;
+
+// Float weights map onto the quantized file as w * ACT_MAX (feature transformer) and
+// w * WEIGHT_SCALE (int8 layers), so keep them inside what those types can hold. The feature
+// transformer limit keeps a full accumulator inside int16.
+constexpr float FT_LIMIT = 32767.0f / Nnue::ACT_MAX / (MAX_FEATURES + 1);
+constexpr float WEIGHT_LIMIT = 127.0f / Nnue::WEIGHT_SCALE;
+
+constexpr float BETA1 = 0.9f;
+constexpr float BETA2 = 0.999f;
+constexpr float EPSILON = 1e-8f;
+
+// ---------------------------------------------------------------------------------------------
+// Kernels, n is always a multiple of 8
+
+struct Kernels {
+	const char *name;
+	void (*add)(float *dst, const float *src, int n);
+	void (*axpy)(float *dst, float a, const float *x, int n); // dst += a * x
+	float (*dot)(const float *a, const float *b, int n);
+};
+
+void addScalar(float *dst, const float *src, int n) {
+	for (int i = 0; i < n; ++i)
+		dst[i] += src[i];
+}
+
+void axpyScalar(float *dst, float a, const float *x, int n) {
+	for (int i = 0; i < n; ++i)
+		dst[i] += a * x[i];
+}
+
+float dotScalar(const float *a, const float *b, int n) {
+	float sum = 0.0f;
+	for (int i = 0; i < n; ++i)
+		sum += a[i] * b[i];
+	return sum;
+}
+
+#ifdef TRAINER_X86
+
+__attribute__((target("avx2,fma"))) void addAvx2(float *dst, const float *src, int n) {
+	for (int i = 0; i < n; i += 8)
+		_mm256_storeu_ps(dst + i,
+		                 _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+}
+
+__attribute__((target("avx2,fma"))) void axpyAvx2(float *dst, float a, const float *x, int n) {
+	const __m256 va = _mm256_set1_ps(a);
+	for (int i = 0; i < n; i += 8)
+		_mm256_storeu_ps(dst + i,
+		                 _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(dst + i)));
+}
+
+__attribute__((target("avx2,fma"))) float dotAvx2(const float *a, const float *b, int n) {
+	__m256 sum = _mm256_setzero_ps();
+	for (int i = 0; i < n; i += 8)
+		sum = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum);
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+	return _mm_cvtss_f32(s);
+}
+
+#endif // TRAINER_X86
+
+const Kernels ScalarKernels = {"scalar", addScalar, axpyScalar, dotScalar};
+#ifdef TRAINER_X86
+const Kernels Avx2Kernels = {"avx2", addAvx2, axpyAvx2, dotAvx2};
+#endif
+
+const Kernels &detectKernels() {
+#ifdef TRAINER_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return Avx2Kernels;
+#endif
+	return ScalarKernels;
+}
+
+const Kernels &kernels = detectKernels();
+
+// ---------------------------------------------------------------------------------------------
+// Samples
+
+struct Sample {
+	int count = 0;                      // active features per perspective
+	uint16_t features[2][MAX_FEATURES]; // side to move first, then the opponent
+	float target = 0.0f;                // expected score in [0, 1]
+};
+
+inline float sigmoid(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+
+// Returns false for records the engine could not have produced (missing king, too many pieces)
+bool decodeSample(const TrainingRecord &r, const TrainerOptions &opts, Sample &s) {
+	int kings[2] = {-1, -1};
+	int pieces[MAX_FEATURES], squares[MAX_FEATURES];
+	const int n = r.position.pieceCount();
+	if (n > MAX_FEATURES)
+		return false;
+	u64 occupied = r.position.occupied();
+	for (int i = 0; i < n; ++i, occupied &= occupied - 1) {
+		int sq64 = __builtin_ctzll(occupied);
+		int p = r.position.piece(i);
+		if (p == EMPTY || p > BK)
+			return false;
+		int sq = ((sq64 >> 3) << 4) | (sq64 & 7);
+		if (p == WK)
+			kings[WHITE] = sq;
+		else if (p == BK)
+			kings[BLACK] = sq;
+		pieces[i] = p;
+		squares[i] = sq;
+	}
+	if (kings[WHITE] < 0 || kings[BLACK] < 0)
+		return false;
+
+	const Color stm = r.position.sideToMove();
+	const Color persp[2] = {stm, opposite(stm)};
+	for (int side = 0; side < 2; ++side)
+		for (int i = 0; i < n; ++i)
+			s.features[side][i] = static_cast<uint16_t>(
+			    Nnue::featureIndex(persp[side], kings[persp[side]], pieces[i], squares[i]));
+	s.count = n;
+
+	float scoreTarget = sigmoid(r.score / opts.scale);
+	float resultTarget = (r.result + 1) * 0.5f;
+	s.target = opts.lambda * scoreTarget + (1.0f - opts.lambda) * resultTarget;
+	return true;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Forward and backward pass
+
+// Per-thread gradient sums; feature transformer rows are tracked so only touched ones are
+// reduced and updated
+struct Gradients {
+	std::vector<float> values = std::vector<float>(PARAM_COUNT, 0.0f);
+	std::vector<uint8_t> touched = std::vector<uint8_t>(INPUTS, 0);
+	std::vector<uint16_t> touchedRows;
+	double loss = 0.0;
+	size_t samples = 0;
+
+	void touch(uint16_t row) {
+		if (!touched[row]) {
+			touched[row] = 1;
+			touchedRows.push_back(row);
+		}
+	}
+};
+
+void trainSample(const float *w, const Sample &s, float outScale, Gradients &g) {
+	alignas(32) float acc[2][L1];
+	alignas(32) float input[2 * L1];
+	alignas(32) float hidden[L2];
+	alignas(32) float act[L2];
+
+	for (int side = 0; side < 2; ++side) {
+		std::memcpy(acc[side], w + FT_BIAS, sizeof(float) * L1);
+		for (int i = 0; i < s.count; ++i)
+			kernels.add(acc[side], w + FT_WEIGHTS + s.features[side][i] * L1, L1);
+		for (int j = 0; j < L1; ++j)
+			input[side * L1 + j] = std::clamp(acc[side][j], 0.0f, 1.0f);
+	}
+
+	for (int o = 0; o < L2; ++o) {
+		hidden[o] = w[L1_BIAS + o] + kernels.dot(input, w + L1_WEIGHTS + o * 2 * L1, 2 * L1);
+		act[o] = std::clamp(hidden[o], 0.0f, 1.0f);
+	}
+	const float y = w[OUT_BIAS] + kernels.dot(act, w + OUT_WEIGHTS, L2);
+
+	// Squared error between predicted and target win probability
+	const float p = sigmoid(y * outScale);
+	const float err = p - s.target;
+	g.loss += err * err;
+	++g.samples;
+
+	float *grad = g.values.data();
+	const float dy = 2.0f * err * p * (1.0f - p) * outScale;
+	grad[OUT_BIAS] += dy;
+	kernels.axpy(grad + OUT_WEIGHTS, dy, act, L2);
+
+	alignas(32) float dInput[2 * L1] = {};
+	for (int o = 0; o < L2; ++o) {
+		if (hidden[o] <= 0.0f || hidden[o] >= 1.0f)
+			continue;
+		const float dh = dy * w[OUT_WEIGHTS + o];
+		grad[L1_BIAS + o] += dh;
+		kernels.axpy(grad + L1_WEIGHTS + o * 2 * L1, dh, input, 2 * L1);
+		kernels.axpy(dInput, dh, w + L1_WEIGHTS + o * 2 * L1, 2 * L1);
+	}
+
+	for (int side = 0; side < 2; ++side) {
+		float *dAcc = dInput + side * L1;
+		for (int j = 0; j < L1; ++j)
+			if (acc[side][j] <= 0.0f || acc[side][j] >= 1.0f)
+				dAcc[j] = 0.0f;
+		kernels.add(grad + FT_BIAS, dAcc, L1);
+		for (int i = 0; i < s.count; ++i) {
+			kernels.add(grad + FT_WEIGHTS + s.features[side][i] * L1, dAcc, L1);
+			g.touch(s.features[side][i]);
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------------------------
+// Optimizer
+
+struct Adam {
+	std::vector<float> m = std::vector<float>(PARAM_COUNT, 0.0f);
+	std::vector<float> v = std::vector<float>(PARAM_COUNT, 0.0f);
+	float lr = 1e-3f;
+	float beta1Power = 1.0f;
+	float beta2Power = 1.0f;
+
+	void nextStep() {
+		beta1Power *= BETA1;
+		beta2Power *= BETA2;
+	}
+
+	void update(float *w, size_t i, float grad, float limit) {
+		m[i] = BETA1 * m[i] + (1.0f - BETA1) * grad;
+		v[i] = BETA2 * v[i] + (1.0f - BETA2) * grad * grad;
+		float mHat = m[i] / (1.0f - beta1Power);
+		float vHat = v[i] / (1.0f - beta2Power);
+		w[i] = std::clamp(w[i] - lr * mHat / (std::sqrt(vHat) + EPSILON), -limit, limit);
+	}
+};
+
+template <typename Fn> void runParallel(int threads, Fn fn) {
+	std::vector<std::thread> pool;
+	for (int t = 1; t < threads; ++t)
+		pool.emplace_back(fn, t);
+	fn(0);
+	for (auto &th : pool)
+		th.join();
+}
+
+float limitFor(size_t i) {
+	if (i < L1_WEIGHTS)
+		return FT_LIMIT;
+	if (i >= L1_BIAS && i < OUT_WEIGHTS)
+		return 1e6f; // biases are stored as int32
+	return i == OUT_BIAS ? 1e6f : WEIGHT_LIMIT;
+}
+
+// Sum the per-thread gradients of one batch into an Adam step and clear them
+void applyGradients(std::vector<float> &w, Adam &adam, std::vector<Gradients> &grads,
+                    size_t batchSamples, std::vector<uint8_t> &rowSeen,
+                    std::vector<uint16_t> &rows) {
+	const float inv = 1.0f / static_cast<float>(batchSamples);
+	const int threads = static_cast<int>(grads.size());
+	adam.nextStep();
+
+	rows.clear();
+	for (Gradients &g : grads) {
+		for (uint16_t row : g.touchedRows) {
+			g.touched[row] = 0;
+			if (!rowSeen[row]) {
+				rowSeen[row] = 1;
+				rows.push_back(row);
+			}
+		}
+		g.touchedRows.clear();
+	}
+
+	runParallel(threads, [&](int t) {
+		for (size_t r = t; r < rows.size(); r += threads) {
+			const size_t base = FT_WEIGHTS + static_cast<size_t>(rows[r]) * L1;
+			for (size_t i = base; i < base + L1; ++i) {
+				float sum = 0.0f;
+				for (Gradients &g : grads) {
+					sum += g.values[i];
+					g.values[i] = 0.0f;
+				}
+				adam.update(w.data(), i, sum * inv, FT_LIMIT);
+			}
+		}
+	});
+	for (uint16_t row : rows)
+		rowSeen[row] = 0;
+
+	for (size_t i = FT_BIAS; i < PARAM_COUNT; ++i) {
+		float sum = 0.0f;
+		for (Gradients &g : grads) {
+			sum += g.values[i];
+			g.values[i] = 0.0f;
+		}
+		adam.update(w.data(), i, sum * inv, limitFor(i));
+	}
+}
+
+// ---------------------------------------------------------------------------------------------
+// Export
+
+bool exportNetwork(const std::vector<float> &w, const std::string &path) {
+	const Nnue::FileLayout layout = Nnue::fileLayout();
+	std::vector<char> buf(layout.total, 0);
+
+	Nnue::FileHeader header{};
+	header.magic = Nnue::FILE_MAGIC;
+	header.version = Nnue::FILE_VERSION;
+	header.inputs = INPUTS;
+	header.l1 = L1;
+	header.l2 = L2;
+	std::memcpy(buf.data(), &header, sizeof(header));
+
+	auto put = [&](size_t offset, size_t index, auto value) {
+		std::memcpy(buf.data() + offset + index * sizeof(value), &value, sizeof(value));
+	};
+	auto q16 = [](float x) { return static_cast<int16_t>(std::lround(x * Nnue::ACT_MAX)); };
+	auto q8 = [](float x) {
+		long q = std::lround(x * Nnue::WEIGHT_SCALE);
+		return static_cast<int8_t>(std::clamp<long>(q, -127, 127));
+	};
+	auto q32 = [](float x) {
+		return static_cast<int32_t>(std::lround(x * Nnue::ACT_MAX * Nnue::WEIGHT_SCALE));
+	};
+
+	for (size_t i = 0; i < static_cast<size_t>(INPUTS) * L1; ++i)
+		put(layout.ftWeights, i, q16(w[FT_WEIGHTS + i]));
+	for (size_t i = 0; i < L1; ++i)
+		put(layout.ftBias, i, q16(w[FT_BIAS + i]));
+	for (size_t i = 0; i < static_cast<size_t>(L2) * 2 * L1; ++i)
+		put(layout.l1Weights, i, q8(w[L1_WEIGHTS + i]));
+	for (size_t i = 0; i < L2; ++i) {
+		put(layout.l1Bias, i, q32(w[L1_BIAS + i]));
+		put(layout.outWeights, i, q8(w[OUT_WEIGHTS + i]));
+	}
+	put(layout.outBias, 0, q32(w[OUT_BIAS]));
+
+	FILE *f = std::fopen(path.c_str(), "wb");
+	if (!f)
+		return false;
+	bool ok = std::fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+	return std::fclose(f) == 0 && ok;
+}
+
+void initWeights(std::vector<float> &w, unsigned seed) {
+	std::mt19937 rng(seed);
+	auto fill = [&](size_t begin, size_t end, float range) {
+		std::uniform_real_distribution<float> dist(-range, range);
+		for (size_t i = begin; i < end; ++i)
+			w[i] = dist(rng);
+	};
+	fill(FT_WEIGHTS, FT_BIAS, 0.05f);
+	std::fill(w.begin() + FT_BIAS, w.begin() + L1_WEIGHTS, 0.5f);
+	fill(L1_WEIGHTS, L1_BIAS, 1.0f / std::sqrt(2.0f * L1));
+	fill(OUT_WEIGHTS, OUT_BIAS, 1.0f / std::sqrt(static_cast<float>(L2)));
+}
+
+} // namespace
+
+int runTrainer(const TrainerOptions &opts) {
+	MappedFile data;
+	if (!data.open(opts.dataPath)) {
+		std::cerr << "Cannot open training data " << opts.dataPath << "\n";
+		return 1;
+	}
+	// Game chains are expanded into records up front; record files are used in place
+	std::vector<TrainingRecord> decoded;
+	const bool chain = opts.dataPath.size() > 6 &&
+	                   opts.dataPath.compare(opts.dataPath.size() - 6, 6, ".chain") == 0;
+	if (chain && !decodeGameChains(data.data(), data.size(), decoded)) {
+		std::cerr << opts.dataPath << " is not a valid game chain file\n";
+		return 1;
+	}
+	if (!chain && data.size() % sizeof(TrainingRecord) != 0) {
+		std::cerr << opts.dataPath << " is not a whole number of training records\n";
+		return 1;
+	}
+	const auto *records =
+	    chain ? decoded.data() : reinterpret_cast<const TrainingRecord *>(data.data());
+	const size_t recordCount = chain ? decoded.size() : data.size() / sizeof(TrainingRecord);
+
+	const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+	const int threads = opts.threads > 0 ? opts.threads : std::max(1, hardware);
+	const size_t batchSize = static_cast<size_t>(std::max(1, opts.batchSize));
+	const float outScale = Nnue::OUTPUT_SCALE / opts.scale;
+
+	std::cout << "Training on " << recordCount << " positions from " << opts.dataPath << ", "
+	          << threads << " threads, batch " << batchSize << ", kernels " << kernels.name << "\n";
+
+	std::vector<float> weights(PARAM_COUNT, 0.0f);
+	initWeights(weights, opts.seed);
+	Adam adam;
+	adam.lr = opts.learningRate;
+
+	std::vector<Gradients> grads(threads);
+	std::vector<uint8_t> rowSeen(INPUTS, 0);
+	std::vector<uint16_t> rows;
+	std::vector<uint32_t> order(recordCount);
+	std::iota(order.begin(), order.end(), 0u);
+	std::mt19937 rng(opts.seed);
+
+	for (int epoch = 1; epoch <= opts.epochs; ++epoch) {
+		auto start = std::chrono::steady_clock::now();
+		std::shuffle(order.begin(), order.end(), rng);
+
+		double epochLoss = 0.0;
+		size_t epochSamples = 0;
+		for (size_t begin = 0; begin < recordCount; begin += batchSize) {
+			const size_t end = std::min(recordCount, begin + batchSize);
+			runParallel(threads, [&](int t) {
+				Gradients &g = grads[t];
+				Sample s;
+				for (size_t i = begin + t; i < end; i += threads)
+					if (decodeSample(records[order[i]], opts, s))
+						trainSample(weights.data(), s, outScale, g);
+			});
+
+			size_t batchSamples = 0;
+			for (Gradients &g : grads) {
+				epochLoss += g.loss;
+				batchSamples += g.samples;
+				g.loss = 0.0;
+				g.samples = 0;
+			}
+			if (batchSamples == 0)
+				continue;
+			epochSamples += batchSamples;
+			applyGradients(weights, adam, grads, batchSamples, rowSeen, rows);
+		}
+
+		double secs =
+		    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		char line[160];
+		std::snprintf(line, sizeof(line),
+		              "epoch %3d  loss %.6f  positions %zu  time %7.2fs  pos/s %10.0f", epoch,
+		              epochSamples ? epochLoss / epochSamples : 0.0, epochSamples, secs,
+		              secs > 0 ? epochSamples / secs : 0.0);
+		std::cout << line << std::endl;
+
+		if (!exportNetwork(weights, opts.outPath)) {
+			std::cerr << "Cannot write network " << opts.outPath << "\n";
+			return 1;
+		}
+	}
+
+	std::cout << "Network written to " << opts.outPath << "\n";
+	return 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+
+struct TrainerOptions {
+	std::string dataPath; // file of TrainingRecords, or game chains if it ends in .chain
+	std::string outPath;  // network written here after every epoch
+	int epochs = 10;
+	int batchSize = 16384;
+	int threads = 0; // 0 uses every hardware thread
+	float learningRate = 1e-3f;
+	float lambda = 0.7f;  // weight of the search score against the game result in the target
+	float scale = 400.0f; // centipawns per unit of the sigmoid mapping scores to win probability
+	unsigned seed = 1;
+};
+
+// Train an evaluation network with mini-batch Adam on the CPU and export it quantized in the
+// format Nnue::loadNetwork reads. Prints loss and positions per second for every epoch and
+// returns a process exit code.
+int runTrainer(const TrainerOptions &opts);
@@ -0,0 +1,52 @@
+#include "training_data.h"
+#include <algorithm>
+#include <cstdio>
+
+TrainingRecord makeTrainingRecord(const Position &pos, int score, int result) {
+	TrainingRecord r{};
+	r.position = packPosition(pos);
+	r.score = static_cast<int16_t>(std::clamp(score, -32000, 32000));
+	r.result = static_cast<int8_t>(result);
+	return r;
+}
+
+bool appendTrainingRecords(const std::string &path, const TrainingRecord *records, size_t count) {
+	FILE *f = std::fopen(path.c_str(), "ab");
+	if (!f)
+		return false;
+	bool ok = std::fwrite(records, sizeof(TrainingRecord), count, f) == count;
+	return std::fclose(f) == 0 && ok;
+}
+
+TrainingWriter::TrainingWriter(const std::string &path, size_t bufferBytes)
+    : file(std::fopen(path.c_str(), "ab")), capacity(std::max<size_t>(1, bufferBytes)) {
+	buffer.reserve(capacity);
+}
+
+TrainingWriter::~TrainingWriter() {
+	if (file) {
+		flush();
+		std::fclose(file);
+	}
+}
+
+bool TrainingWriter::writeBytes(const void *data, size_t size) {
+	const auto *bytes = static_cast<const uint8_t *>(data);
+	std::lock_guard<std::mutex> lock(mutex);
+	buffer.insert(buffer.end(), bytes, bytes + size);
+	return buffer.size() >= capacity ? flushLocked() : !failed;
+}
+
+bool TrainingWriter::flush() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return flushLocked() && std::fflush(file) == 0;
+}
+
+bool TrainingWriter::flushLocked() {
+	if (!file)
+		return false;
+	if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+		failed = true;
+	buffer.clear();
+	return !failed;
+}
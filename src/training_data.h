@@ -0,0 +1,50 @@
+#pragma once
+#include "packed_position.h"
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One labelled training position as stored on disk. score is the search score in centipawns
+// and result the game outcome (1 win, 0 draw, -1 loss), both from the side to move's point of
+// view.
+struct TrainingRecord {
+	PackedPosition position;
+	int16_t score;
+	int8_t result;
+	uint8_t reserved;
+};
+static_assert(sizeof(TrainingRecord) == 36, "training records are stored as raw 36-byte structs");
+
+TrainingRecord makeTrainingRecord(const Position &pos, int score, int result);
+
+// Append records to a file; returns false on I/O errors
+bool appendTrainingRecords(const std::string &path, const TrainingRecord *records, size_t count);
+
+// Appends records (or encoded game chains) to one file through a shared buffer so concurrent
+// producers only take a lock per batch and the file sees large sequential writes
+class TrainingWriter {
+  public:
+	explicit TrainingWriter(const std::string &path, size_t bufferBytes = 4 << 20);
+	~TrainingWriter();
+	TrainingWriter(const TrainingWriter &) = delete;
+	TrainingWriter &operator=(const TrainingWriter &) = delete;
+
+	bool isOpen() const { return file != nullptr; }
+	// Thread-safe; returns false once a write has failed
+	bool write(const TrainingRecord *records, size_t count) {
+		return writeBytes(records, count * sizeof(TrainingRecord));
+	}
+	bool writeBytes(const void *data, size_t size);
+	bool flush();
+
+  private:
+	bool flushLocked();
+
+	FILE *file = nullptr;
+	std::vector<uint8_t> buffer;
+	size_t capacity;
+	bool failed = false;
+	std::mutex mutex;
+};
@@ -0,0 +1,252 @@
+#include "tt.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <thread>
+#include <unistd.h>
+
+// Largest power of two not above n (n >= 1)
+static size_t floorPow2(size_t n) {
+	size_t p = 1;
+	while (p * 2 <= n)
+		p *= 2;
+	return p;
+}
+
+namespace {
+
+constexpr uint32_t SHARED_READY = 1;
+constexpr uint32_t SHARED_VERSION = 3; // bump with any change to the header or the data word
+constexpr u64 SHARED_MAGIC = 0x0054547373656843ULL; // "ChessTT" in memory
+constexpr size_t SHARED_SLOTS_OFFSET = 512;
+constexpr int SHARED_MAX_ATTACHED = 64;
+
+// A process that crashed never detaches, so liveness is asked of the pid instead
+bool processAlive(int32_t pid) { return pid > 0 && (::kill(pid, 0) == 0 || errno == EPERM); }
+
+} // namespace
+
+// Start of a shared segment; the slots follow at SHARED_SLOTS_OFFSET. The creator records its
+// pid, fills in the layout and only then sets state to READY, and every other process checks
+// the layout before touching a slot. If the creator dies first, the next process to attach
+// initializes the segment in its place.
+struct TranspositionTable::SharedHeader {
+	std::atomic<uint32_t> state;
+	uint32_t version;
+	u64 magic;
+	u64 slotSize;
+	u64 count;
+	std::atomic<uint32_t> generation;
+	std::atomic<int32_t> creator;
+	std::atomic<u64> probes;
+	std::atomic<u64> hits;
+	// Pid of each attached table, 0 for a free entry. Entries of processes that died without
+	// detaching are not counted and are reused by the next attach.
+	std::atomic<int32_t> attached[SHARED_MAX_ATTACHED];
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+                  sizeof(std::atomic<u64>) == sizeof(u64),
+              "shared atomics must be plain words");
+
+TranspositionTable::TranspositionTable(size_t mb) { resize(mb); }
+
+TranspositionTable::~TranspositionTable() { detach(); }
+
+void TranspositionTable::resize(size_t mb) {
+	detach();
+	size_t bytes = (mb ? mb : 1) * 1024 * 1024;
+	count = floorPow2(bytes / sizeof(Slot));
+	owned.reset(new Slot[count]);
+	slots = owned.get();
+	generation = 0;
+}
+
+void TranspositionTable::clear() {
+	if (header) {
+		generation = (header->generation.fetch_add(1, std::memory_order_relaxed) + 1) & 0x3F;
+		return;
+	}
+	for (size_t i = 0; i < count; ++i) {
+		slots[i].keyXorData.store(0, std::memory_order_relaxed);
+		slots[i].data.store(0, std::memory_order_relaxed);
+	}
+	generation = 0;
+}
+
+void TranspositionTable::newSearch() {
+	// A shared table ages only when some process clears it: searches in other processes run
+	// concurrently with this one, and aging their entries would let shallow results replace them
+	if (header)
+		generation = header->generation.load(std::memory_order_relaxed) & 0x3F;
+	else
+		generation = (generation + 1) & 0x3F;
+}
+
+bool TranspositionTable::attachShared(const std::string &name, size_t mb, std::string *error) {
+	auto fail = [&](const std::string &what) {
+		if (error)
+			*error = what;
+		return false;
+	};
+	static_assert(SHARED_SLOTS_OFFSET >= sizeof(SharedHeader), "header overlaps the slots");
+	const size_t wanted = floorPow2((mb ? mb : 1) * 1024 * 1024 / sizeof(Slot));
+
+	SharedMemory segment;
+	bool created = false;
+	if (!segment.open(name, SHARED_SLOTS_OFFSET + wanted * sizeof(Slot), created, error))
+		return false;
+	auto *h = static_cast<SharedHeader *>(segment.data());
+
+	auto initialize = [&](u64 slotCount) {
+		// ftruncate zero-filled the slots and counters
+		h->version = SHARED_VERSION;
+		h->magic = SHARED_MAGIC;
+		h->slotSize = sizeof(Slot);
+		h->count = slotCount;
+		h->state.store(SHARED_READY, std::memory_order_release);
+	};
+	const int32_t self = static_cast<int32_t>(::getpid());
+	if (created) {
+		h->creator.store(self, std::memory_order_relaxed);
+		initialize(wanted);
+	} else {
+		for (int tries = 0; h->state.load(std::memory_order_acquire) != SHARED_READY; ++tries) {
+			// Take over from a creator that died, or never got as far as recording its pid
+			int32_t creator = h->creator.load(std::memory_order_relaxed);
+			const bool abandoned = creator == 0 ? tries >= 100 : !processAlive(creator);
+			if (abandoned && h->creator.compare_exchange_strong(creator, self)) {
+				if (segment.size() < SHARED_SLOTS_OFFSET + sizeof(Slot))
+					return fail("shared hash " + name + " is too small");
+				initialize(floorPow2((segment.size() - SHARED_SLOTS_OFFSET) / sizeof(Slot)));
+				break;
+			}
+			if (tries == 200)
+				return fail("shared hash " + name + " was never initialized");
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		if (h->magic != SHARED_MAGIC || h->version != SHARED_VERSION ||
+		    h->slotSize != sizeof(Slot))
+			return fail("shared hash " + name + " has an incompatible layout");
+		if (h->count == 0 || (h->count & (h->count - 1)) != 0 ||
+		    SHARED_SLOTS_OFFSET + h->count * sizeof(Slot) > segment.size())
+			return fail("shared hash " + name + " has a corrupt header");
+	}
+
+	detach();
+	owned.reset();
+	shared = std::move(segment);
+	header = h;
+	slots = reinterpret_cast<Slot *>(static_cast<char *>(shared.data()) + SHARED_SLOTS_OFFSET);
+	count = header->count;
+	generation = header->generation.load(std::memory_order_relaxed) & 0x3F;
+	// Past SHARED_MAX_ATTACHED live tables the table still works but is not counted
+	attachedIndex = -1;
+	for (int i = 0; i < SHARED_MAX_ATTACHED && attachedIndex < 0; ++i) {
+		int32_t pid = header->attached[i].load(std::memory_order_relaxed);
+		if ((pid == 0 || !processAlive(pid)) &&
+		    header->attached[i].compare_exchange_strong(pid, self))
+			attachedIndex = i;
+	}
+	return true;
+}
+
+void TranspositionTable::detach() {
+	if (!header)
+		return;
+	if (attachedIndex >= 0)
+		header->attached[attachedIndex].store(0, std::memory_order_relaxed);
+	attachedIndex = -1;
+	header = nullptr;
+	slots = nullptr;
+	count = 0;
+	shared.close();
+}
+
+bool TranspositionTable::sharedStats(SharedStats &out) const {
+	if (!header)
+		return false;
+	out.probes = header->probes.load(std::memory_order_relaxed);
+	out.hits = header->hits.load(std::memory_order_relaxed);
+	out.attached = 0;
+	for (const std::atomic<int32_t> &pid : header->attached)
+		out.attached += processAlive(pid.load(std::memory_order_relaxed));
+	return true;
+}
+
+void TranspositionTable::recordProbes(u64 probes, u64 hits) {
+	if (!header)
+		return;
+	header->probes.fetch_add(probes, std::memory_order_relaxed);
+	header->hits.fetch_add(hits, std::memory_order_relaxed);
+}
+
+// Data word layout: score (32) | depth (8) | bound (2) | generation (6) | move (16)
+bool TranspositionTable::probe(u64 key, TTEntry &out) const {
+	const Slot &s = slots[key & (count - 1)];
+	u64 data = s.data.load(std::memory_order_relaxed);
+	u64 check = s.keyXorData.load(std::memory_order_relaxed);
+	if ((check ^ data) != key || data == 0)
+		return false;
+
+	out.score = static_cast<int32_t>(data >> 32);
+	out.depth = static_cast<int8_t>((data >> 24) & 0xFF);
+	out.bound = static_cast<TTBound>((data >> 22) & 0x3);
+	out.move = static_cast<uint16_t>(data & 0xFFFF);
+	return true;
+}
+
+void TranspositionTable::store(u64 key, int score, int depth, TTBound bound, uint16_t move) {
+	Slot &s = slots[key & (count - 1)];
+
+	u64 old = s.data.load(std::memory_order_relaxed);
+	bool sameKey = (s.keyXorData.load(std::memory_order_relaxed) ^ old) == key;
+	if (sameKey && old != 0) {
+		int oldDepth = static_cast<int8_t>((old >> 24) & 0xFF);
+		uint8_t oldGeneration = (old >> 16) & 0x3F;
+		if (bound != BOUND_EXACT && depth < oldDepth && oldGeneration == generation)
+			return;
+		// Keep the known best move when this result has none
+		if (move == 0)
+			move = static_cast<uint16_t>(old & 0xFFFF);
+	}
+
+	u64 data = (static_cast<u64>(static_cast<uint32_t>(score)) << 32) |
+	           (static_cast<u64>(static_cast<uint8_t>(depth)) << 24) |
+	           (static_cast<u64>(bound) << 22) | (static_cast<u64>(generation) << 16) | move;
+	s.data.store(data, std::memory_order_relaxed);
+	s.keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+	const size_t sample = std::min<size_t>(count, 1000);
+	size_t used = 0;
+	for (size_t i = 0; i < sample; ++i) {
+		u64 data = slots[i].data.load(std::memory_order_relaxed);
+		if (data != 0 && ((data >> 16) & 0x3F) == generation)
+			++used;
+	}
+	return static_cast<int>(used * 1000 / sample);
+}
+
+EvalCache::EvalCache(size_t mb) { resize(mb); }
+
+void EvalCache::resize(size_t mb) {
+	if (mb == 0) {
+		entries.reset();
+		mask = 0;
+		return;
+	}
+	size_t count = floorPow2(mb * 1024 * 1024 / sizeof(u64));
+	entries.reset(new std::atomic<u64>[count]);
+	mask = count - 1;
+	clear();
+}
+
+void EvalCache::clear() {
+	if (!entries)
+		return;
+	for (u64 i = 0; i <= mask; ++i)
+		entries[i].store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "move.h"
+#include "shared_memory.h"
+#include "types.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+enum TTBound : uint8_t { BOUND_NONE = 0, BOUND_UPPER = 1, BOUND_LOWER = 2, BOUND_EXACT = 3 };
+
+struct TTEntry {
+	int score = 0;
+	int depth = 0;
+	TTBound bound = BOUND_NONE;
+	uint16_t move = 0; // packed from/to/promotion, 0 if none
+};
+
+// Pack the parts of a move needed to find it again among generated moves:
+// from (6 bits) | to (6 bits) | promotion piece type (3 bits). 0 means no move.
+inline uint16_t packMove(const Move &m) {
+	int from = ((m.from >> 4) << 3) | (m.from & 7);
+	int to = ((m.to >> 4) << 3) | (m.to & 7);
+	return static_cast<uint16_t>(from | (to << 6) | (pieceType(m.promotion) << 12));
+}
+
+// Shared hash table of search results. Each slot is two 64-bit words, the key XOR-ed with the
+// data and the data itself, so a torn write from another thread fails the key check instead of
+// returning a mixed entry. The same holds across processes when the slots live in a named
+// shared-memory segment (attachShared).
+class TranspositionTable {
+  public:
+	explicit TranspositionTable(size_t mb = 16);
+	~TranspositionTable();
+
+	TranspositionTable(const TranspositionTable &) = delete;
+	TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+	// Replaces the table, shared or not, with an empty private one
+	void resize(size_t mb);
+	// A shared table is left to the other processes using it; only the generation moves on
+	void clear();
+	// Age the entries of earlier searches so new results replace them. A shared table keeps
+	// the generation its last clear set, which every process attached to it uses.
+	void newSearch();
+
+	// Use the table in the shared-memory segment name, creating it with mb megabytes if no
+	// process has yet. False, keeping the private table, when the segment cannot be mapped or
+	// was laid out by an incompatible build.
+	bool attachShared(const std::string &name, size_t mb, std::string *error = nullptr);
+	bool isShared() const { return header != nullptr; }
+
+	// Totals over every search of every process attached to a shared table
+	struct SharedStats {
+		u64 probes = 0;
+		u64 hits = 0;
+		uint32_t attached = 0; // tables of live processes mapping it now
+		double hitRate() const { return probes ? static_cast<double>(hits) / probes : 0.0; }
+	};
+	bool sharedStats(SharedStats &out) const;
+	// Add one search's probes and hits to the shared totals; nothing for a private table
+	void recordProbes(u64 probes, u64 hits);
+
+	bool probe(u64 key, TTEntry &out) const;
+	void store(u64 key, int score, int depth, TTBound bound, uint16_t move);
+
+	size_t size() const { return count; }
+	size_t bytes() const { return count * sizeof(Slot); }
+	// Per mille of a sample of slots written during the current search
+	int hashfull() const;
+
+  private:
+	struct Slot {
+		std::atomic<u64> keyXorData{0};
+		std::atomic<u64> data{0};
+	};
+
+	struct SharedHeader;
+	static_assert(std::atomic<u64>::is_always_lock_free, "slots must be lock-free to share");
+
+	void detach();
+
+	std::unique_ptr<Slot[]> owned;
+	SharedMemory shared;
+	SharedHeader *header = nullptr; // at the start of a shared segment
+	int attachedIndex = -1;         // this table's entry in header->attached
+	Slot *slots = nullptr;          // owned or in the shared segment
+	size_t count = 0;
+	uint8_t generation = 0;
+};
+
+// Direct-mapped cache of static evaluations. An entry is a single 64-bit word holding the upper
+// 48 bits of the key and the 16-bit score, so loads and stores are atomic without locking.
+// A cache of 0 MB holds no entries; callers check enabled() instead of probing it.
+class EvalCache {
+  public:
+	explicit EvalCache(size_t mb = 1);
+
+	void resize(size_t mb);
+	void clear();
+
+	bool enabled() const { return entries != nullptr; }
+	size_t bytes() const { return entries ? (mask + 1) * sizeof(u64) : 0; }
+
+	bool probe(u64 key, int &score) const {
+		u64 e = entries[key & mask].load(std::memory_order_relaxed);
+		if (((e ^ key) & ~0xFFFFULL) != 0)
+			return false;
+		score = static_cast<int16_t>(e & 0xFFFF);
+		return true;
+	}
+
+	void store(u64 key, int score) {
+		u64 e = (key & ~0xFFFFULL) | static_cast<uint16_t>(static_cast<int16_t>(score));
+		entries[key & mask].store(e, std::memory_order_relaxed);
+	}
+
+  private:
+	std::unique_ptr<std::atomic<u64>[]> entries;
+	u64 mask = 0;
+};
@@ -0,0 +1,389 @@
+#include "tuner.h"
+#include "epd_reader.h"
+#include "eval_params.h"
+#include "evaluate.h"
+#include "mapped_file.h"
+#include "nnue.h"
+#include "psqt.h"
+#include "search.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TUNER_X86 1
+#endif
+
+namespace {
+
+// Coefficient rows are padded so kernels can work in blocks of 32
+constexpr int STRIDE = (EVAL_TERMS + 31) & ~31;
+
+constexpr double LN10 = 2.302585092994046;
+constexpr float BETA1 = 0.9f;
+constexpr float BETA2 = 0.999f;
+constexpr float EPSILON = 1e-8f;
+
+// ---------------------------------------------------------------------------------------------
+// Kernels over one coefficient row, n a multiple of 8
+
+struct Kernels {
+	const char *name;
+	// mg = sum c[i] * wMg[i], eg = sum c[i] * wEg[i]
+	void (*dot)(const int8_t *c, const float *wMg, const float *wEg, int n, float &mg,
+	            float &eg);
+	// gMg[i] += a * c[i], gEg[i] += b * c[i]
+	void (*accumulate)(const int8_t *c, float a, float b, float *gMg, float *gEg, int n);
+};
+
+void dotScalar(const int8_t *c, const float *wMg, const float *wEg, int n, float &mg,
+               float &eg) {
+	float sumMg = 0.0f, sumEg = 0.0f;
+	for (int i = 0; i < n; ++i) {
+		sumMg += c[i] * wMg[i];
+		sumEg += c[i] * wEg[i];
+	}
+	mg = sumMg;
+	eg = sumEg;
+}
+
+void accumulateScalar(const int8_t *c, float a, float b, float *gMg, float *gEg, int n) {
+	for (int i = 0; i < n; ++i) {
+		gMg[i] += a * c[i];
+		gEg[i] += b * c[i];
+	}
+}
+
+#ifdef TUNER_X86
+
+__attribute__((target("avx2,fma"))) inline __m256 loadCoef(const int8_t *c) {
+	__m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(c));
+	return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+}
+
+__attribute__((target("avx2,fma"))) inline float horizontalSum(__m256 v) {
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+	return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2,fma"))) void dotAvx2(const int8_t *c, const float *wMg,
+                                                 const float *wEg, int n, float &mg, float &eg) {
+	__m256 sumMg = _mm256_setzero_ps();
+	__m256 sumEg = _mm256_setzero_ps();
+	for (int i = 0; i < n; i += 8) {
+		__m256 x = loadCoef(c + i);
+		sumMg = _mm256_fmadd_ps(x, _mm256_loadu_ps(wMg + i), sumMg);
+		sumEg = _mm256_fmadd_ps(x, _mm256_loadu_ps(wEg + i), sumEg);
+	}
+	mg = horizontalSum(sumMg);
+	eg = horizontalSum(sumEg);
+}
+
+__attribute__((target("avx2,fma"))) void accumulateAvx2(const int8_t *c, float a, float b,
+                                                        float *gMg, float *gEg, int n) {
+	const __m256 va = _mm256_set1_ps(a);
+	const __m256 vb = _mm256_set1_ps(b);
+	for (int i = 0; i < n; i += 8) {
+		__m256 x = loadCoef(c + i);
+		_mm256_storeu_ps(gMg + i, _mm256_fmadd_ps(va, x, _mm256_loadu_ps(gMg + i)));
+		_mm256_storeu_ps(gEg + i, _mm256_fmadd_ps(vb, x, _mm256_loadu_ps(gEg + i)));
+	}
+}
+
+#endif // TUNER_X86
+
+const Kernels ScalarKernels = {"scalar", dotScalar, accumulateScalar};
+#ifdef TUNER_X86
+const Kernels Avx2Kernels = {"avx2", dotAvx2, accumulateAvx2};
+#endif
+
+const Kernels &detectKernels() {
+#ifdef TUNER_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return Avx2Kernels;
+#endif
+	return ScalarKernels;
+}
+
+const Kernels &kernels = detectKernels();
+
+// ---------------------------------------------------------------------------------------------
+// Dataset
+
+// Cached terms of every quiet position, one STRIDE-wide row each
+struct TuneSet {
+	size_t size = 0;
+	std::vector<int8_t> coef;
+	std::vector<float> mgWeight; // phase / MAX_PHASE
+	std::vector<float> result;   // 1 White win, 0.5 draw, 0 Black win
+};
+
+// Game result from a "1-0" / "0-1" / "1/2-1/2" string or a bracketed "[1.0]" style score
+bool parseResult(std::string_view line, float &result) {
+	if (line.find("1/2-1/2") != std::string_view::npos) {
+		result = 0.5f;
+		return true;
+	}
+	if (line.find("1-0") != std::string_view::npos) {
+		result = 1.0f;
+		return true;
+	}
+	if (line.find("0-1") != std::string_view::npos) {
+		result = 0.0f;
+		return true;
+	}
+	size_t open = line.rfind('[');
+	if (open == std::string_view::npos)
+		return false;
+	std::string_view v = line.substr(open + 1);
+	if (v.substr(0, 3) == "0.5") {
+		result = 0.5f;
+		return true;
+	}
+	if (!v.empty() && (v[0] == '0' || v[0] == '1')) {
+		result = v[0] == '1' ? 1.0f : 0.0f;
+		return true;
+	}
+	return false;
+}
+
+template <typename Fn> void runParallel(int threads, Fn fn) {
+	std::vector<std::thread> pool;
+	for (int t = 1; t < threads; ++t)
+		pool.emplace_back(fn, t);
+	fn(0);
+	for (auto &th : pool)
+		th.join();
+}
+
+// Resolve each position to the end of its quiescence line and trace the evaluation there. Chunks
+// of the file are parsed in parallel into their own sets and joined in file order.
+TuneSet buildTuneSet(std::string_view text, int threads, size_t &skipped) {
+	const std::vector<std::string_view> chunks = splitLineChunks(text, threads * 16);
+	std::vector<TuneSet> parts(chunks.size());
+	std::atomic<size_t> rejected{0};
+
+	forEachChunk(chunks, threads, [&](size_t c, std::string_view chunk) {
+		TuneSet &part = parts[c];
+		Position pos;
+		EvalTrace trace;
+		std::vector<Move> pv;
+		forEachLine(chunk, [&](std::string_view line) {
+			float result;
+			if (!parseResult(line, result) || !pos.setFromFEN(line) ||
+			    pos.inCheck(pos.sideToMove)) {
+				++rejected;
+				return;
+			}
+
+			SearchContext ctx;
+			quiescence(pos, -MATE_SCORE, MATE_SCORE, ctx, &pv);
+			for (const Move &m : pv)
+				pos.makeMove(m);
+
+			traceEvaluation(pos, trace);
+			part.coef.insert(part.coef.end(), trace.coef, trace.coef + EVAL_TERMS);
+			part.coef.resize(part.coef.size() + STRIDE - EVAL_TERMS, 0);
+			part.mgWeight.push_back(static_cast<float>(trace.phase) / MAX_PHASE);
+			part.result.push_back(result);
+			++part.size;
+		});
+	});
+
+	TuneSet set;
+	for (const TuneSet &part : parts)
+		set.size += part.size;
+	set.coef.reserve(set.size * STRIDE);
+	set.mgWeight.reserve(set.size);
+	set.result.reserve(set.size);
+	for (TuneSet &part : parts) {
+		set.coef.insert(set.coef.end(), part.coef.begin(), part.coef.end());
+		set.mgWeight.insert(set.mgWeight.end(), part.mgWeight.begin(), part.mgWeight.end());
+		set.result.insert(set.result.end(), part.result.begin(), part.result.end());
+		part = TuneSet();
+	}
+	skipped = rejected;
+	return set;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Error and gradient
+
+struct Weights {
+	std::vector<float> mg = std::vector<float>(STRIDE, 0.0f);
+	std::vector<float> eg = std::vector<float>(STRIDE, 0.0f);
+};
+
+inline float evalRow(const TuneSet &set, size_t i, const Weights &w) {
+	float mg, eg;
+	kernels.dot(&set.coef[i * STRIDE], w.mg.data(), w.eg.data(), STRIDE, mg, eg);
+	return mg * set.mgWeight[i] + eg * (1.0f - set.mgWeight[i]);
+}
+
+inline double winProbability(double k, double eval) {
+	return 1.0 / (1.0 + std::pow(10.0, -k * eval / 400.0));
+}
+
+double meanError(const TuneSet &set, const Weights &w, double k, int threads) {
+	std::vector<double> partial(threads, 0.0);
+	runParallel(threads, [&](int t) {
+		double sum = 0.0;
+		for (size_t i = t; i < set.size; i += threads) {
+			double diff = set.result[i] - winProbability(k, evalRow(set, i, w));
+			sum += diff * diff;
+		}
+		partial[t] = sum;
+	});
+	double total = 0.0;
+	for (double p : partial)
+		total += p;
+	return set.size ? total / set.size : 0.0;
+}
+
+// Golden-section search for the sigmoid scale that best fits the current evaluation
+double fitK(const TuneSet &set, const Weights &w, int threads) {
+	const double ratio = (std::sqrt(5.0) - 1.0) / 2.0;
+	double lo = 0.1, hi = 3.0;
+	double a = hi - ratio * (hi - lo), b = lo + ratio * (hi - lo);
+	double ea = meanError(set, w, a, threads), eb = meanError(set, w, b, threads);
+	for (int iter = 0; iter < 30; ++iter) {
+		if (ea < eb) {
+			hi = b;
+			b = a;
+			eb = ea;
+			a = hi - ratio * (hi - lo);
+			ea = meanError(set, w, a, threads);
+		} else {
+			lo = a;
+			a = b;
+			ea = eb;
+			b = lo + ratio * (hi - lo);
+			eb = meanError(set, w, b, threads);
+		}
+	}
+	return (lo + hi) / 2.0;
+}
+
+// Gradient of the mean squared error, returns the error itself
+double gradient(const TuneSet &set, const Weights &w, double k, int threads, Weights &grad) {
+	std::vector<Weights> partial(threads);
+	std::vector<double> errors(threads, 0.0);
+	runParallel(threads, [&](int t) {
+		Weights &g = partial[t];
+		double sum = 0.0;
+		for (size_t i = t; i < set.size; i += threads) {
+			double p = winProbability(k, evalRow(set, i, w));
+			double diff = set.result[i] - p;
+			sum += diff * diff;
+			float d = static_cast<float>(-2.0 * diff * p * (1.0 - p) * k * LN10 / 400.0);
+			float mgWeight = set.mgWeight[i];
+			kernels.accumulate(&set.coef[i * STRIDE], d * mgWeight, d * (1.0f - mgWeight),
+			                   g.mg.data(), g.eg.data(), STRIDE);
+		}
+		errors[t] = sum;
+	});
+
+	const float inv = set.size ? 1.0f / set.size : 0.0f;
+	double error = 0.0;
+	grad = Weights();
+	for (int t = 0; t < threads; ++t) {
+		error += errors[t];
+		for (int i = 0; i < STRIDE; ++i) {
+			grad.mg[i] += partial[t].mg[i] * inv;
+			grad.eg[i] += partial[t].eg[i] * inv;
+		}
+	}
+	return set.size ? error / set.size : 0.0;
+}
+
+void storeParams(const Weights &w) {
+	for (int term = 0; term < EVAL_TERMS; ++term) {
+		evalParams[2 * term] = static_cast<int>(std::lround(w.mg[term]));
+		evalParams[2 * term + 1] = static_cast<int>(std::lround(w.eg[term]));
+	}
+	refreshPsqtTables();
+}
+
+} // namespace
+
+int runTuner(const TunerOptions &opts) {
+	if (Nnue::isLoaded()) {
+		std::cerr << "Tuning works on the classical evaluation; run it without --eval-file\n";
+		return 1;
+	}
+
+	MappedFile epd;
+	if (!epd.open(opts.epdPath)) {
+		std::cerr << "Cannot open " << opts.epdPath << "\n";
+		return 1;
+	}
+
+	const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+	const int threads = opts.threads > 0 ? opts.threads : std::max(1, hardware);
+
+	auto start = std::chrono::steady_clock::now();
+	size_t skipped = 0;
+	TuneSet set = buildTuneSet(std::string_view(epd.data(), epd.size()), threads, skipped);
+	epd.close();
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::printf("Loaded %zu positions (%zu skipped) in %.2fs, %d threads, kernels %s\n",
+	            set.size, skipped, secs, threads, kernels.name);
+	if (set.size == 0)
+		return 1;
+
+	Weights w;
+	for (int term = 0; term < EVAL_TERMS; ++term) {
+		w.mg[term] = static_cast<float>(paramMg(term));
+		w.eg[term] = static_cast<float>(paramEg(term));
+	}
+
+	const double k = opts.k > 0.0 ? opts.k : fitK(set, w, threads);
+	std::printf("K %.4f  initial error %.6f\n", k, meanError(set, w, k, threads));
+
+	Weights m, v, grad;
+	float beta1Power = 1.0f, beta2Power = 1.0f;
+	for (int epoch = 1; epoch <= opts.epochs; ++epoch) {
+		start = std::chrono::steady_clock::now();
+		double error = gradient(set, w, k, threads, grad);
+
+		beta1Power *= BETA1;
+		beta2Power *= BETA2;
+		auto step = [&](std::vector<float> &wv, std::vector<float> &mv, std::vector<float> &vv,
+		                const std::vector<float> &gv) {
+			for (int i = 0; i < EVAL_TERMS; ++i) {
+				mv[i] = BETA1 * mv[i] + (1.0f - BETA1) * gv[i];
+				vv[i] = BETA2 * vv[i] + (1.0f - BETA2) * gv[i] * gv[i];
+				float mHat = mv[i] / (1.0f - beta1Power);
+				float vHat = vv[i] / (1.0f - beta2Power);
+				wv[i] -= opts.learningRate * mHat / (std::sqrt(vHat) + EPSILON);
+			}
+		};
+		step(w.mg, m.mg, v.mg, grad.mg);
+		step(w.eg, m.eg, v.eg, grad.eg);
+
+		secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::printf("epoch %4d  error %.6f  time %6.3fs  pos/s %10.0f\n", epoch, error, secs,
+		            secs > 0 ? set.size / secs : 0.0);
+		std::fflush(stdout);
+
+		storeParams(w);
+		if (!saveEvalParams(opts.outPath)) {
+			std::cerr << "Cannot write " << opts.outPath << "\n";
+			return 1;
+		}
+	}
+
+	std::printf("Final error %.6f, parameters written to %s\n", meanError(set, w, k, threads),
+	            opts.outPath.c_str());
+	return 0;
+}
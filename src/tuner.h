@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+
+struct TunerOptions {
+	// Positions labelled with a game result, e.g. `<fen> c9 "1-0";` or `<fen> [0.5]`
+	std::string epdPath;
+	std::string outPath; // parameter file written after every epoch
+	int epochs = 100;
+	int threads = 0;           // 0 uses every hardware thread
+	float learningRate = 1.0f; // Adam step size, in centipawns
+	double k = 0.0;            // sigmoid scale; 0 fits it to the data first
+};
+
+// Texel tuning of the classical evaluation parameters. Every position is resolved to a quiet
+// one with quiescence search, its evaluation terms are cached, and the mean squared error
+// between game result and sigmoid(evaluation) is minimised with gradient descent. Returns a
+// process exit code.
+int runTuner(const TunerOptions &opts);
@@ -0,0 +1,351 @@
+#include "uci.h"
+#include "engine_session.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+constexpr int MAX_UCI_DEPTH = 64;
+constexpr int MAX_HASH_MB = 4096;
+constexpr int MAX_MOVE_OVERHEAD_MS = 5000;
+
+std::mutex outMutex;
+
+void send(const std::string &line) {
+	std::lock_guard<std::mutex> lock(outMutex);
+	std::cout << line << '\n' << std::flush;
+}
+
+std::string lowercase(std::string s) {
+	for (char &c : s)
+		c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	return s;
+}
+
+std::string scoreString(int score) {
+	if (!isMateScore(score))
+		return "cp " + std::to_string(score);
+	return "mate " + std::to_string(mateInMoves(score));
+}
+
+bool findUciMove(Position &pos, const std::string &token, Move &out) {
+	std::vector<Move> moves;
+	GenerateLegalMoves(pos, moves);
+	for (const Move &m : moves) {
+		if (MoveToUci(m) == token) {
+			out = m;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Arguments of one go command; negative clock times were not given
+struct GoCommand {
+	int time[2] = {-1, -1};
+	int inc[2] = {0, 0};
+	int movesToGo = 0;
+	int depth = 0;
+	u64 nodes = 0;
+	int moveTime = 0;
+	bool infinite = false;
+	bool ponder = false;
+};
+
+class UciEngine {
+  public:
+	UciEngine() : tt(cfg.hashMb), evalCache(cfg.evalCacheMb) {
+		cfg.multiPV = 1;
+		pos.setStartPosition();
+	}
+
+	~UciEngine() { stopSearch(); }
+
+	// Returns false on quit
+	bool handle(const std::string &line) {
+		std::istringstream in(line);
+		std::string cmd;
+		in >> cmd;
+		if (cmd == "uci")
+			identify();
+		else if (cmd == "isready")
+			send("readyok");
+		else if (cmd == "ucinewgame") {
+			stopSearch();
+			tt.clear();
+			evalCache.clear();
+			pos.setStartPosition();
+		} else if (cmd == "setoption") {
+			stopSearch();
+			setOption(in);
+		} else if (cmd == "position")
+			setPosition(in);
+		else if (cmd == "go")
+			go(in);
+		else if (cmd == "stop")
+			stopSearch();
+		else if (cmd == "ponderhit") {
+			std::lock_guard<std::mutex> lock(mutex);
+			ponderFlag = false;
+			wake.notify_all();
+		} else if (cmd == "quit")
+			return false;
+		return true;
+	}
+
+  private:
+	EngineConfig cfg;
+	int moveOverheadMs = 30;
+	TranspositionTable tt;
+	EvalCache evalCache;
+	Position pos;
+
+	std::thread searcher;
+	std::atomic<bool> stopFlag{false};
+	std::atomic<bool> ponderFlag{false};
+	std::mutex mutex;
+	std::condition_variable wake; // stop or ponderhit for a search waiting to report
+
+	void identify() {
+		send("id name ChessEngine");
+		send("id author CoffeeWOSugar");
+		send("option name Hash type spin default " + std::to_string(cfg.hashMb) +
+		     " min 1 max " + std::to_string(MAX_HASH_MB));
+		send("option name EvalCache type spin default " + std::to_string(cfg.evalCacheMb) +
+		     " min 0 max " + std::to_string(MAX_HASH_MB));
+		// The search is single threaded; the option exists for GUIs that always set it
+		send("option name Threads type spin default 1 min 1 max 1");
+		send("option name MultiPV type spin default 1 min 1 max " + std::to_string(MAX_MULTIPV));
+		send("option name Ponder type check default false");
+		send("option name Move Overhead type spin default " + std::to_string(moveOverheadMs) +
+		     " min 0 max " + std::to_string(MAX_MOVE_OVERHEAD_MS));
+		const SearchParams defaults;
+		for (const SearchParamSpec &spec : SearchParamSpecs)
+			send(std::string("option name ") + spec.name + " type spin default " +
+			     std::to_string(defaults.*spec.field) + " min " + std::to_string(spec.min) +
+			     " max " + std::to_string(spec.max));
+		send("uciok");
+	}
+
+	// setoption name <name> [value <value>], where the name may contain spaces
+	void setOption(std::istringstream &in) {
+		std::string token, name, value;
+		in >> token;
+		while (in >> token && token != "value")
+			name += (name.empty() ? "" : " ") + token;
+		while (in >> token)
+			value += (value.empty() ? "" : " ") + token;
+		name = lowercase(name);
+
+		if (name == "ponder" || name == "threads")
+			return;
+		if (name == "move overhead") {
+			moveOverheadMs = std::clamp(std::stoi(value), 0, MAX_MOVE_OVERHEAD_MS);
+		} else if (name == "hash") {
+			setEngineOption(cfg, "hash", std::clamp(std::stoi(value), 1, MAX_HASH_MB));
+			tt.resize(cfg.hashMb);
+		} else if (name == "evalcache") {
+			setEngineOption(cfg, "evalcache", std::clamp(std::stoi(value), 0, MAX_HASH_MB));
+			evalCache.resize(cfg.evalCacheMb);
+		} else if (name == "multipv") {
+			setEngineOption(cfg, "multipv", std::clamp(std::stoi(value), 1, MAX_MULTIPV));
+		} else {
+			// Other config fields, such as depth and time, have no effect here
+			const bool tunable =
+			    std::any_of(SearchParamSpecs.begin(), SearchParamSpecs.end(),
+			                [&](const SearchParamSpec &spec) { return name == spec.name; });
+			if (!tunable || !setEngineOption(cfg, name, std::stoi(value)))
+				send("info string unknown option " + name);
+		}
+	}
+
+	// position startpos|fen <fen> [moves <uci>...]
+	void setPosition(std::istringstream &in) {
+		std::string token, fen;
+		in >> token;
+		Position next;
+		if (token == "startpos") {
+			next.setStartPosition();
+			in >> token;
+		} else if (token == "fen") {
+			while (in >> token && token != "moves")
+				fen += token + " ";
+			if (!next.setFromFEN(fen)) {
+				send("info string invalid fen " + fen);
+				return;
+			}
+		} else {
+			return;
+		}
+
+		if (token == "moves") {
+			while (in >> token) {
+				Move m{};
+				if (!findUciMove(next, token, m) || !next.makeMove(m)) {
+					send("info string illegal move " + token);
+					break;
+				}
+			}
+		}
+		pos = next;
+	}
+
+	void go(std::istringstream &in) {
+		stopSearch();
+
+		GoCommand go;
+		std::string token;
+		while (in >> token) {
+			if (token == "infinite")
+				go.infinite = true;
+			else if (token == "ponder")
+				go.ponder = true;
+			else if (token == "searchmoves") // not supported; the moves are skipped
+				break;
+			else {
+				std::string value;
+				if (!(in >> value))
+					break;
+				if (token == "wtime")
+					go.time[WHITE] = std::stoi(value);
+				else if (token == "btime")
+					go.time[BLACK] = std::stoi(value);
+				else if (token == "winc")
+					go.inc[WHITE] = std::stoi(value);
+				else if (token == "binc")
+					go.inc[BLACK] = std::stoi(value);
+				else if (token == "movestogo")
+					go.movesToGo = std::stoi(value);
+				else if (token == "depth")
+					go.depth = std::stoi(value);
+				else if (token == "nodes")
+					go.nodes = std::stoull(value);
+				else if (token == "movetime")
+					go.moveTime = std::stoi(value);
+			}
+		}
+
+		stopFlag = false;
+		ponderFlag = go.ponder;
+		searcher = std::thread(&UciEngine::search, this, pos, go);
+	}
+
+	void search(Position root, GoCommand go) {
+		SearchContext ctx;
+		ctx.params = cfg.search;
+		ctx.tt = &tt;
+		ctx.evalCache = evalCache.enabled() ? &evalCache : nullptr;
+		ctx.limits.stop = &stopFlag;
+		ctx.limits.ponder = &ponderFlag;
+		ctx.limits.maxNodes = go.nodes;
+
+		const auto now = std::chrono::steady_clock::now();
+		const Color us = root.sideToMove;
+		if (go.moveTime > 0) {
+			ctx.limits.useTime = true;
+			ctx.limits.endTime =
+			    now + std::chrono::milliseconds(std::max(1, go.moveTime - moveOverheadMs));
+		} else if (go.time[us] >= 0 && !go.infinite) {
+			SearchParams params = cfg.search;
+			if (go.movesToGo > 0)
+				params.timeMovesToGo = std::min(params.timeMovesToGo, go.movesToGo);
+			const int remaining = std::max(1, go.time[us] - moveOverheadMs);
+			ctx.limits.useTime = true;
+			ctx.limits.endTime =
+			    now + std::chrono::milliseconds(allocateTime(params, remaining, go.inc[us]));
+		}
+		const int depth = go.depth > 0 ? std::min(go.depth, MAX_UCI_DEPTH) : MAX_UCI_DEPTH;
+
+		// Every completed depth prints its lines; in between the throttled info reporter
+		// prints the counters when they moved on
+		u64 printedNodes = 0;
+		auto counters = [&](u64 nodes) {
+			const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+			                         std::chrono::steady_clock::now() - ctx.startTime)
+			                         .count();
+			const u64 nps = elapsed > 0 ? nodes * 1000000 / static_cast<u64>(elapsed) : 0;
+			printedNodes = nodes;
+			return "seldepth " + std::to_string(ctx.stats.seldepth) + " nodes " +
+			       std::to_string(nodes) + " nps " + std::to_string(nps) + " hashfull " +
+			       std::to_string(tt.hashfull()) + " time " + std::to_string(elapsed / 1000);
+		};
+		PVReporter report = [&](const std::vector<PVLine> &lines) {
+			for (size_t i = 0; i < lines.size(); ++i) {
+				std::string line = "info depth " + std::to_string(lines[i].depth) + " " +
+				                   counters(ctx.stats.nodes) + " multipv " +
+				                   std::to_string(i + 1) + " score " +
+				                   scoreString(lines[i].score) + " pv";
+				for (const Move &m : lines[i].moves)
+					line += " " + MoveToUci(m);
+				send(line);
+			}
+		};
+		ctx.info = [&](const SearchInfo &info) {
+			if (info.nodes != printedNodes)
+				send("info depth " + std::to_string(info.depth) + " " + counters(info.nodes));
+		};
+
+		std::vector<PVLine> lines;
+		searchMultiPV(root, depth, cfg.multiPV, ctx, lines, report);
+
+		// bestmove may not be sent before stop while pondering or searching infinitely
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopFlag || (!go.infinite && !ponderFlag); });
+		}
+
+		std::string best = "0000";
+		if (!lines.empty()) {
+			const std::vector<Move> &pv = lines.front().moves;
+			best = MoveToUci(pv.front());
+			if (pv.size() > 1)
+				best += " ponder " + MoveToUci(pv[1]);
+		} else {
+			// Stopped before the first depth finished; any legal move beats none
+			std::vector<Move> moves;
+			GenerateLegalMoves(root, moves);
+			if (!moves.empty())
+				best = MoveToUci(moves.front());
+		}
+		send("bestmove " + best);
+	}
+
+	void stopSearch() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopFlag = true;
+			ponderFlag = false;
+			wake.notify_all();
+		}
+		if (searcher.joinable())
+			searcher.join();
+	}
+};
+
+} // namespace
+
+int runUci(const std::string &firstCommand) {
+	UciEngine engine;
+	if (!firstCommand.empty() && !engine.handle(firstCommand))
+		return 0;
+
+	std::string line;
+	while (std::getline(std::cin, line)) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		try {
+			if (!engine.handle(line))
+				break;
+		} catch (const std::exception &e) {
+			send(std::string("info string error: ") + e.what());
+		}
+	}
+	return 0;
+}
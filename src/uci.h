@@ -0,0 +1,11 @@
+#pragma once
+#include <string>
+
+// Universal Chess Interface front end on standard input and output, for GUIs and tournament
+// managers. Supports uci, isready, ucinewgame, setoption (Hash, EvalCache, Threads, MultiPV,
+// Ponder, Move Overhead and every SearchParamSpecs name), position startpos|fen ...
+// [moves ...], go with wtime/btime/winc/binc/movestogo/depth/nodes/movetime/infinite/ponder,
+// stop, ponderhit and quit. Searches run on their own thread so stop and isready are answered
+// while thinking. firstCommand, if given, is handled before reading input. Returns a process
+// exit code.
+int runUci(const std::string &firstCommand = "");
@@ -0,0 +1,37 @@
+#include "zobrist.h"
+
+namespace Zobrist {
+u64 pieceSquare[13][128];
+u64 castling[16];
+u64 epFile[8];
+u64 side;
+} // namespace Zobrist
+
+namespace {
+
+// xorshift64* with a fixed seed so keys (and anything keyed on them) are reproducible
+u64 nextRandom(u64 &state) {
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 2685821657736338717ULL;
+}
+
+struct ZobristInit {
+	ZobristInit() {
+		u64 state = 1070372ULL;
+		for (int p = WP; p <= BK; ++p)
+			for (int sq = 0; sq < 128; ++sq)
+				Zobrist::pieceSquare[p][sq] = (sq & 0x88) ? 0 : nextRandom(state);
+		for (u64 &k : Zobrist::castling)
+			k = nextRandom(state);
+		Zobrist::castling[0] = 0;
+		for (u64 &k : Zobrist::epFile)
+			k = nextRandom(state);
+		Zobrist::side = nextRandom(state);
+	}
+};
+
+const ZobristInit zobristInit;
+
+} // namespace
@@ -0,0 +1,11 @@
+#pragma once
+#include "types.h"
+
+// Random keys for incremental position hashing. Entries for EMPTY are zero so that XOR-ing a
+// vacated or uncaptured square in and out is a no-op.
+namespace Zobrist {
+extern u64 pieceSquare[13][128];
+extern u64 castling[16];
+extern u64 epFile[8];
+extern u64 side;
+} // namespace Zobrist
@@ -0,0 +1,123 @@
+#include "draw_tests.h"
+#include "test_util.h"
+#include "../src/engine_session.h"
+#include "../src/movegen.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Play UCI moves on pos; false if one is not legal
+bool play(Position &pos, const std::vector<std::string> &uciMoves) {
+	std::vector<Move> moves;
+	for (const std::string &uci : uciMoves) {
+		GenerateLegalMoves(pos, moves);
+		bool found = false;
+		for (const Move &m : moves) {
+			if (MoveToUci(m) == uci) {
+				found = pos.makeMove(m);
+				break;
+			}
+		}
+		if (!found)
+			return false;
+	}
+	return true;
+}
+
+const std::vector<std::string> KNIGHT_SHUFFLE = {"g1f3", "g8f6", "f3g1", "f6g8"};
+
+} // namespace
+
+void run_draw_tests() {
+	std::cout << "Running draw detection tests..." << std::endl;
+	bool all_good = true;
+	Position pos;
+
+	// Threefold: the start position recurs after each knight shuffle
+	pos.setStartPosition();
+	expect(play(pos, KNIGHT_SHUFFLE), "knight shuffle", all_good);
+	expect(!pos.isRepetition(), "second occurrence is not yet a threefold", all_good);
+	expect(play(pos, {"g1f3"}) && !pos.isRepetition(), "second occurrence after g1f3",
+	       all_good);
+	expect(play(pos, {"g8f6", "f3g1", "f6g8"}) && pos.isRepetition(),
+	       "third occurrence of the start position", all_good);
+
+	// Inside the search tree a single earlier occurrence counts, but only within searchPly
+	pos.setStartPosition();
+	play(pos, KNIGHT_SHUFFLE);
+	expect(pos.isRepetition(4), "repetition four plies into the search", all_good);
+	expect(!pos.isRepetition(3), "repetition before the search root", all_good);
+
+	// The same after a pawn move, which limits how far back the history is searched
+	pos.setStartPosition();
+	play(pos, {"e2e3", "e7e6"});
+	play(pos, KNIGHT_SHUFFLE);
+	play(pos, KNIGHT_SHUFFLE);
+	expect(pos.isRepetition(), "threefold after pawn moves", all_good);
+
+	// Fifty moves: 100 plies, and a quiet move at 99 reaches it
+	pos.setFromFEN("4k3/8/8/8/8/8/4P3/R3K3 w - - 99 80");
+	expect(!pos.isFiftyMoveDraw(), "halfmove clock 99", all_good);
+	expect(play(pos, {"a1a2"}) && pos.isFiftyMoveDraw(), "halfmove clock 100", all_good);
+	pos.setFromFEN("4k3/8/8/8/8/8/4P3/R3K3 w - - 99 80");
+	expect(play(pos, {"e2e3"}) && !pos.isFiftyMoveDraw(), "pawn move at 99 resets the clock",
+	       all_good);
+
+	struct MaterialCase {
+		const char *name;
+		const char *fen;
+		bool insufficient;
+	};
+	const std::vector<MaterialCase> material = {
+	    {"KK", "8/8/4k3/8/8/4K3/8/8 w - - 0 1", true},
+	    {"KNK", "8/8/4k3/8/8/3NK3/8/8 w - - 0 1", true},
+	    {"KBK", "8/8/4k3/8/8/3BK3/8/8 b - - 0 1", true},
+	    {"KBKB same colour", "8/8/2b1k3/8/8/3BK3/8/8 w - - 0 1", true},
+	    {"KBKB opposite colours", "8/8/3bk3/8/8/3BK3/8/8 w - - 0 1", false},
+	    {"KNKN", "8/8/3nk3/8/8/3NK3/8/8 w - - 0 1", false},
+	    {"KBNK", "8/8/4k3/8/8/2NBK3/8/8 w - - 0 1", false},
+	    {"KPK", "8/8/4k3/8/8/4K3/4P3/8 w - - 0 1", false},
+	    {"KRK", "8/8/4k3/8/8/4K3/8/R7 w - - 0 1", false},
+	};
+	for (const MaterialCase &mc : material) {
+		pos.setFromFEN(mc.fen);
+		expect(pos.isInsufficientMaterial() == mc.insufficient,
+		       std::string("insufficient material of ") + mc.name, all_good);
+	}
+
+	// The session reports every status, checkmate ahead of the fifty-move rule
+	struct StatusCase {
+		const char *name;
+		const char *fen;
+		GameResult result;
+	};
+	const std::vector<StatusCase> statuses = {
+	    {"ongoing", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	     GameResult::ONGOING},
+	    {"checkmate", "rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3",
+	     GameResult::CHECKMATE},
+	    {"checkmate on the hundredth ply", "R5k1/5ppp/8/8/8/8/8/6K1 b - - 100 90",
+	     GameResult::CHECKMATE},
+	    {"stalemate", "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1", GameResult::STALEMATE},
+	    {"fifty moves", "4k3/8/8/8/8/8/4P3/R3K3 w - - 100 80", GameResult::FIFTY_MOVES},
+	    {"insufficient material", "8/8/4k3/8/8/3NK3/8/8 w - - 0 1",
+	     GameResult::INSUFFICIENT_MATERIAL},
+	};
+	EngineSession session;
+	for (const StatusCase &sc : statuses) {
+		expect(session.setPosition(sc.fen) && session.getGameResult() == sc.result,
+		       std::string("session status ") + sc.name, all_good);
+	}
+	session.newGame(WHITE);
+	Move applied{};
+	std::string error;
+	for (int round = 0; round < 2; ++round)
+		for (const std::string &mv : KNIGHT_SHUFFLE)
+			session.applyHumanMove(mv, applied, error);
+	expect(session.getGameResult() == GameResult::REPETITION, "session status repetition",
+	       all_good);
+
+	reportSuite(all_good, "draw detection", "repetition, fifty-move, material and game status");
+}
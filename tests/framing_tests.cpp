@@ -0,0 +1,115 @@
+#include "framing_tests.h"
+#include "test_util.h"
+#include "../src/framing.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Read {
+	MessageReader::Result result;
+	json message;
+};
+
+// Feed the chunks through a pipe, pausing between them so each arrives in its own read, and
+// collect what a MessageReader makes of them up to the end of input
+std::vector<Read> readAll(WireFormat format, const std::vector<std::string> &chunks) {
+	int fds[2];
+	if (::pipe(fds) != 0)
+		return {};
+	std::thread writer([&] {
+		for (const std::string &chunk : chunks) {
+			writeAll(fds[1], chunk);
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		::close(fds[1]);
+	});
+	std::vector<Read> reads;
+	MessageReader reader(fds[0]);
+	for (Read r{}; (r.result = reader.next(format, r.message)) != MessageReader::END;)
+		reads.push_back(r);
+	writer.join();
+	::close(fds[0]);
+	return reads;
+}
+
+} // namespace
+
+void run_framing_tests() {
+	std::cout << "Running framing tests..." << std::endl;
+	bool all_good = true;
+
+	const json message{{"event", "analysis"},
+	                   {"id", 42},
+	                   {"lines", {{{"depth", 9}, {"score", -35}, {"pv", {"e2e4", "e7e5"}}}}},
+	                   {"stats", {{"nodes", 123456789012ULL}, {"tt_hit_rate", 0.25}}},
+	                   {"busy", false}};
+
+	for (WireFormat format : {WireFormat::JSON_LINES, WireFormat::CBOR, WireFormat::MSGPACK}) {
+		const std::string name = wireFormatName(format);
+		const std::string wire = encodeMessage(message, format);
+
+		// Two messages, the first split in the middle of its payload
+		const size_t half = wire.size() / 2;
+		std::vector<Read> reads = readAll(format, {wire.substr(0, half), wire.substr(half), wire});
+		expect(reads.size() == 2 && reads[0].result == MessageReader::MESSAGE &&
+		           reads[0].message == message && reads[1].message == message,
+		       name + " round trip across split reads", all_good);
+
+		if (format == WireFormat::JSON_LINES) {
+			reads = readAll(format, {"{not json\n", wire});
+			expect(reads.size() == 2 && reads[0].result == MessageReader::INVALID &&
+			           reads[1].message == message,
+			       "json line skipped after an invalid one", all_good);
+			continue;
+		}
+
+		// A length prefix split across reads still frames the message
+		reads = readAll(format, {wire.substr(0, 2), wire.substr(2)});
+		expect(reads.size() == 1 && reads[0].message == message,
+		       name + " length prefix split across reads", all_good);
+
+		// A frame whose payload does not decode is skipped, not fatal
+		std::string garbage("\0\0\0\3\xff\xff\xff", 7);
+		reads = readAll(format, {garbage, wire});
+		expect(reads.size() == 2 && reads[0].result == MessageReader::INVALID &&
+		           reads[1].message == message,
+		       name + " undecodable frame skipped", all_good);
+
+		// Truncated prefixes and payloads, and lengths too large to trust, end the input
+		expect(readAll(format, {wire.substr(0, 3)}).empty(), name + " truncated length prefix",
+		       all_good);
+		expect(readAll(format, {wire.substr(0, wire.size() - 1)}).empty(),
+		       name + " truncated payload", all_good);
+		reads = readAll(format, {std::string("\x7f\xff\xff\xff", 4) + wire});
+		expect(reads.empty(), name + " oversized length prefix", all_good);
+	}
+
+	// Negotiation: only a hello switches formats, and unknown formats keep JSON lines
+	WireFormat format = WireFormat::JSON_LINES;
+	json reply;
+	expect(negotiateWireFormat({{"cmd", "hello"}, {"format", "msgpack"}}, format, reply) &&
+	           format == WireFormat::MSGPACK && reply["format"] == "msgpack",
+	       "hello switching to msgpack", all_good);
+	format = WireFormat::JSON_LINES;
+	expect(negotiateWireFormat({{"cmd", "hello"}, {"format", "xml"}}, format, reply) &&
+	           format == WireFormat::JSON_LINES && reply["event"] == "error",
+	       "unknown format staying on json lines", all_good);
+	expect(negotiateWireFormat({{"cmd", "hello"}, {"format", 3}}, format, reply) &&
+	           format == WireFormat::JSON_LINES && reply["event"] == "error",
+	       "non-string format staying on json lines", all_good);
+	expect(negotiateWireFormat({{"cmd", "hello"}}, format, reply) &&
+	           format == WireFormat::JSON_LINES && reply["format"] == "json",
+	       "hello without a format", all_good);
+	expect(!negotiateWireFormat({{"cmd", "state"}}, format, reply) &&
+	           format == WireFormat::JSON_LINES,
+	       "ordinary first request", all_good);
+
+	reportSuite(all_good, "framing", "json, cbor and msgpack framing and negotiation");
+}
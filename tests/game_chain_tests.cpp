@@ -0,0 +1,122 @@
+#include "game_chain_tests.h"
+#include "test_util.h"
+#include "../src/game_chain.h"
+#include "../src/movegen.h"
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The record decodeGameChains must produce for a scored position
+struct Expected {
+	std::string fen;
+	PackedPosition packed;
+	int16_t score;
+	int8_t result;
+};
+
+// Play a random game of up to maxPlies from start, appending it to chain and its scored
+// positions to expected
+bool encodeRandomGame(const Position &start, std::mt19937_64 &rng, int maxPlies,
+                      std::vector<uint8_t> &chain, std::vector<Expected> &expected) {
+	Position pos = start;
+	std::vector<ChainPly> plies;
+	std::vector<std::pair<Position, int16_t>> scored;
+	std::vector<Move> moves;
+	for (int ply = 0; ply < maxPlies; ++ply) {
+		GenerateLegalMoves(pos, moves);
+		if (moves.empty())
+			break;
+		int16_t score = CHAIN_NO_SCORE;
+		if (rng() % 4 != 0) {
+			score = static_cast<int16_t>(static_cast<int>(rng() % 4001) - 2000);
+			scored.emplace_back(pos, score);
+		}
+		const Move m = moves[rng() % moves.size()];
+		plies.push_back(ChainPly{m, score});
+		pos.makeMove(m);
+	}
+	const int white = static_cast<int>(rng() % 3) - 1;
+	if (!encodeGameChain(start, plies, white, chain))
+		return false;
+	for (const auto &[p, score] : scored) {
+		const int8_t result = static_cast<int8_t>(p.sideToMove == WHITE ? white : -white);
+		expected.push_back(Expected{p.toFEN(), packPosition(p), score, result});
+	}
+	return true;
+}
+
+} // namespace
+
+void run_game_chain_tests() {
+	std::cout << "Running game chain tests..." << std::endl;
+
+	bool all_good = true;
+	std::mt19937_64 rng(3);
+	std::vector<uint8_t> chain;
+	std::vector<Expected> expected;
+	size_t encoded = 0;
+
+	// Games from the start position, from fixed positions, and from positions reached by
+	// random play that went through a pack/unpack round trip first
+	std::vector<Position> starts(1);
+	starts[0].setStartPosition();
+	for (const char *fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	                        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 b - - 3 40"}) {
+		starts.emplace_back();
+		starts.back().setFromFEN(fen);
+	}
+	std::vector<Move> moves;
+	for (int i = 0; i < 10; ++i) {
+		Position pos;
+		pos.setStartPosition();
+		for (int ply = 0; ply < 20 + i * 3; ++ply) {
+			GenerateLegalMoves(pos, moves);
+			if (moves.empty())
+				break;
+			pos.makeMove(moves[rng() % moves.size()]);
+		}
+		Position unpacked;
+		if (unpackPosition(packPosition(pos), unpacked))
+			starts.push_back(unpacked);
+	}
+
+	for (int game = 0; game < 40; ++game) {
+		expect(encodeRandomGame(starts[game % starts.size()], rng, 160, chain, expected),
+		       "encoding random game " + std::to_string(game), all_good);
+		++encoded;
+	}
+
+	std::vector<TrainingRecord> records;
+	size_t games = 0;
+	const char *data = reinterpret_cast<const char *>(chain.data());
+	const bool chainDecoded = decodeGameChains(data, chain.size(), records, &games);
+	if (expect(chainDecoded && games == encoded && records.size() == expected.size(),
+	           "decoded " + std::to_string(games) + " games and " +
+	               std::to_string(records.size()) + " records, expected " +
+	               std::to_string(encoded) + " and " + std::to_string(expected.size()),
+	           all_good)) {
+		for (size_t i = 0; i < records.size(); ++i) {
+			const TrainingRecord &r = records[i];
+			const Expected &e = expected[i];
+			Position decoded;
+			const bool same = unpackPosition(r.position, decoded) && decoded.toFEN() == e.fen &&
+			                  std::memcmp(&r.position, &e.packed, sizeof(PackedPosition)) == 0 &&
+			                  r.score == e.score && r.result == e.result;
+			if (!expect(same, "chain record " + std::to_string(i) + " of " + e.fen, all_good))
+				break;
+		}
+	}
+
+	// A chain cut short must be rejected
+	records.clear();
+	expect(!decodeGameChains(data, chain.size() - 1, records), "truncated chain rejected",
+	       all_good);
+
+	reportSuite(all_good, "game chain",
+	            "game chain round trip of " + std::to_string(encoded) + " games, " +
+	                std::to_string(expected.size()) + " records");
+}
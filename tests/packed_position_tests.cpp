@@ -0,0 +1,73 @@
+#include "packed_position_tests.h"
+#include "test_util.h"
+#include "../src/movegen.h"
+#include "../src/packed_position.h"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool roundTrip(const Position &pos) {
+	Position decoded;
+	if (!unpackPosition(packPosition(pos), decoded))
+		return false;
+	return decoded.toFEN() == pos.toFEN() && decoded.key == pos.key;
+}
+
+} // namespace
+
+void run_packed_position_tests() {
+	std::cout << "Running packed position tests..." << std::endl;
+
+	const std::vector<std::string> fens = {
+	    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+	    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 b - - 99 212",
+	    "4k3/8/8/8/8/8/8/4K3 w - - 0 1",
+	};
+
+	bool all_good = true;
+	Position pos;
+	for (const std::string &fen : fens) {
+		pos.setFromFEN(fen);
+		expect(roundTrip(pos), "packed round trip of " + fen, all_good);
+	}
+
+	// Kings and pawns the search cannot handle are rejected by both decoders
+	const std::vector<std::string> invalid = {
+	    "8/8/8/8/8/8/8/8 w - - 0 1",
+	    "4k3/8/8/8/8/8/8/R7 w - - 0 1",
+	    "4k2P/8/8/8/8/8/8/4K3 b - - 0 1",
+	    "4k3/8/8/8/8/8/8/p3K3 w - - 0 1",
+	    "4k3/8/8/8/8/8/8/3KK3 w - - 0 1",
+	};
+	for (const std::string &fen : invalid)
+		expect(!pos.setFromFEN(fen), "rejected invalid FEN " + fen, all_good);
+	pos.setStartPosition();
+	pos.setPiece(Position::makeSquare(4, 0), EMPTY);
+	Position decoded;
+	expect(!unpackPosition(packPosition(pos), decoded), "rejected packed position without a king",
+	       all_good);
+
+	// Positions along random games, covering captures, promotions and en passant squares
+	std::mt19937_64 rng(1);
+	std::vector<Move> moves;
+	int checked = 0;
+	for (int game = 0; game < 50; ++game) {
+		pos.setStartPosition();
+		for (int ply = 0; ply < 200; ++ply) {
+			GenerateLegalMoves(pos, moves);
+			if (moves.empty())
+				break;
+			pos.makeMove(moves[rng() % moves.size()]);
+			++checked;
+			expect(roundTrip(pos), "packed round trip of " + pos.toFEN(), all_good);
+		}
+	}
+
+	reportSuite(all_good, "packed position",
+	            "packed round trip of " + std::to_string(fens.size() + checked) + " positions");
+}
@@ -0,0 +1,93 @@
+#include "pawn_tests.h"
+#include "test_util.h"
+#include "../src/eval_params.h"
+#include "../src/movegen.h"
+#include "../src/pawns.h"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct PawnCase {
+	std::string name;
+	std::string fen;
+	// White minus black counts of each pawn term
+	int doubled, isolated, backward, supported, phalanx;
+	std::vector<std::pair<int, int>> passed; // (relative rank, count)
+	u64 passedWhite, passedBlack;
+};
+
+u64 squareBit(int file, int rank) { return 1ULL << (rank * 8 + file); }
+
+bool sameEntry(const PawnEntry &a, const PawnEntry &b) {
+	return a.mg == b.mg && a.eg == b.eg && a.passed[WHITE] == b.passed[WHITE] &&
+	       a.passed[BLACK] == b.passed[BLACK];
+}
+
+} // namespace
+
+void run_pawn_tests() {
+	std::cout << "Running pawn structure tests..." << std::endl;
+
+	const std::vector<PawnCase> cases = {
+	    // The rear pawn of a doubled passer is neither passed nor counted as one
+	    {"doubled passer", "4k3/8/8/8/4P3/4P3/8/4K3 w - - 0 1", 1, 2, 0, 0, 0, {{3, 1}},
+	     squareBit(4, 3), 0},
+	    {"phalanx and support", "4k3/8/8/8/3PP3/2P5/8/4K3 w - - 0 1", 0, 0, 0, 1, 2,
+	     {{2, 1}, {3, 2}}, squareBit(2, 2) | squareBit(3, 3) | squareBit(4, 3), 0},
+	    // d3 cannot advance past the e5 pawn and has no pawn behind it on an adjacent file
+	    {"backward", "4k3/8/8/4p3/4P3/3P4/8/4K3 w - - 0 1", 0, -1, 1, 1, 0, {}, 0, 0},
+	    {"black passer", "4k3/8/8/8/8/8/p7/4K3 b - - 0 1", 0, -1, 0, 0, 0, {{6, -1}}, 0,
+	     squareBit(0, 1)},
+	};
+
+	bool all_good = true;
+	Position pos;
+	for (const PawnCase &tc : cases) {
+		pos.setFromFEN(tc.fen);
+		PawnEntry entry;
+		EvalTrace trace;
+		evaluatePawns(pos, entry, &trace);
+
+		int expectedPassed[8] = {};
+		for (const auto &[rank, count] : tc.passed)
+			expectedPassed[rank] = count;
+		bool ok = trace.coef[TERM_DOUBLED] == tc.doubled &&
+		          trace.coef[TERM_ISOLATED] == tc.isolated &&
+		          trace.coef[TERM_BACKWARD] == tc.backward &&
+		          trace.coef[TERM_SUPPORTED] == tc.supported &&
+		          trace.coef[TERM_PHALANX] == tc.phalanx &&
+		          entry.passed[WHITE] == tc.passedWhite && entry.passed[BLACK] == tc.passedBlack;
+		for (int r = 0; r < 8; ++r)
+			ok = ok && trace.coef[TERM_PASSED + r] == expectedPassed[r];
+		expect(ok, std::string("[") + tc.name + "] pawn terms of " + tc.fen, all_good);
+	}
+
+	// Hashed entries, hits and colliding slots alike, must equal a fresh evaluation
+	PawnHashTable table(1 << 6);
+	std::mt19937_64 rng(7);
+	std::vector<Move> moves;
+	int checked = 0;
+	for (int game = 0; game < 20; ++game) {
+		pos.setStartPosition();
+		for (int ply = 0; ply < 150; ++ply) {
+			GenerateLegalMoves(pos, moves);
+			if (moves.empty())
+				break;
+			pos.makeMove(moves[rng() % moves.size()]);
+			PawnEntry fresh;
+			evaluatePawns(pos, fresh);
+			expect(sameEntry(table.probe(pos), fresh), "hashed pawn entry of " + pos.toFEN(),
+			       all_good);
+			++checked;
+		}
+	}
+	expect(table.hits > 0, "pawn hash hits", all_good);
+
+	reportSuite(all_good, "pawn structure",
+	            "pawn terms of " + std::to_string(cases.size()) + " structures, pawn hash over " +
+	                std::to_string(checked) + " positions (" + std::to_string(table.hits) +
+	                " hits)");
+}
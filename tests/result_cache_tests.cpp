@@ -0,0 +1,116 @@
+#include "result_cache_tests.h"
+#include "test_util.h"
+#include "../src/engine_session.h"
+#include "../src/move.h"
+#include "../src/result_cache.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// One line of the given depth; every entry made here takes the same number of bytes
+ResultCache::Entry makeEntry(int depth, int timeMs = 0, u64 nodes = 0) {
+	ResultCache::Entry entry;
+	PVLine line;
+	line.depth = depth;
+	line.moves.resize(4);
+	entry.lines.push_back(line);
+	entry.timeMs = timeMs;
+	entry.nodes = nodes;
+	return entry;
+}
+
+bool search(EngineSession &session, int depth, std::vector<PVLine> &lines) {
+	return session.search(depth, SearchLimits{}, 1, lines);
+}
+
+} // namespace
+
+void run_result_cache_tests() {
+	std::cout << "Running result cache tests..." << std::endl;
+	bool all_good = true;
+
+	// An entry answers a search it got at least as far as under any one of the limits
+	const ResultCache::Entry e = makeEntry(6, 100, 1000);
+	expect(e.satisfies(6, 0, 0) && e.satisfies(5, 0, 0), "deep enough", all_good);
+	expect(!e.satisfies(7, 0, 0), "too shallow without other limits", all_good);
+	expect(e.satisfies(9, 100, 0) && !e.satisfies(9, 200, 0), "time limit", all_good);
+	expect(e.satisfies(9, 0, 1000) && !e.satisfies(9, 0, 2000), "node limit", all_good);
+	expect(!ResultCache::Entry{}.satisfies(0, 0, 0), "entry without lines", all_good);
+
+	ResultCache::Entry out;
+	ResultCache cache;
+	cache.store(1, 1, makeEntry(3));
+	expect(!cache.enabled() && !cache.probe(1, 1, out) && cache.stats().entries == 0,
+	       "capacity 0 disables the cache", all_good);
+
+	// Only a deeper entry replaces one, and the number of lines is part of the key
+	cache.setCapacity(1 << 20);
+	cache.store(1, 1, makeEntry(6));
+	cache.store(1, 1, makeEntry(5));
+	expect(cache.probe(1, 1, out) && out.depth() == 6, "shallower entry kept out", all_good);
+	cache.store(1, 1, makeEntry(8));
+	expect(cache.probe(1, 1, out) && out.depth() == 8, "deeper entry replaces", all_good);
+	expect(!cache.probe(1, 2, out), "other multiPV misses", all_good);
+
+	// Least recently used goes first once three entries fill the capacity
+	const size_t entryBytes = cache.stats().bytes;
+	cache.setCapacity(0);
+	cache.setCapacity(3 * entryBytes);
+	for (u64 key = 1; key <= 3; ++key)
+		cache.store(key, 1, makeEntry(4));
+	cache.probe(1, 1, out);
+	cache.store(4, 1, makeEntry(4));
+	expect(!cache.probe(2, 1, out), "least recently used evicted", all_good);
+	expect(cache.probe(1, 1, out) && cache.probe(3, 1, out) && cache.probe(4, 1, out),
+	       "recently used entries kept", all_good);
+	ResultCache::Stats stats = cache.stats();
+	expect(stats.entries == 3 && stats.bytes <= stats.capacity, "cache within capacity",
+	       all_good);
+	cache.setCapacity(entryBytes);
+	expect(cache.stats().entries == 1 && cache.probe(4, 1, out), "shrinking evicts", all_good);
+
+	// Through a session: a shallower entry seeds the search, a deep enough one answers it
+	ResultCache &shared = resultCache();
+	shared.setCapacity(1 << 20);
+	const ResultCache::Stats before = shared.stats();
+	EngineSession first, second;
+	std::vector<PVLine> lines;
+	expect(search(first, 4, lines), "first search", all_good);
+	expect(search(second, 6, lines) && !lines.empty() && lines.front().depth == 6,
+	       "seeded search reaches its depth", all_good);
+	stats = shared.stats();
+	expect(stats.seeds == before.seeds + 1 && stats.hits == before.hits,
+	       "shallower entry seeds", all_good);
+	std::vector<PVLine> cached;
+	expect(search(first, 5, cached) && first.lastSearchStats().nodes == 0 &&
+	           !cached.empty() && cached.front().depth == 6 &&
+	           MoveToUci(cached.front().moves.front()) == MoveToUci(lines.front().moves.front()),
+	       "deeper entry answers", all_good);
+	expect(shared.stats().hits == before.hits + 1, "hit counted", all_good);
+
+	// The key leaves out the game's history, so a search it can change bypasses the cache
+	const std::vector<std::string> shuffle = {"g1f3", "g8f6", "f3g1", "f6g8"};
+	EngineSession repeated;
+	Move applied{};
+	std::string error;
+	for (const std::string &mv : shuffle)
+		repeated.applyHumanMove(mv, applied, error);
+	expect(repeated.position().key == first.position().key, "shuffle returns to the start",
+	       all_good);
+	stats = shared.stats();
+	expect(search(repeated, 4, lines) && repeated.lastSearchStats().nodes > 0 &&
+	           shared.stats().probes == stats.probes,
+	       "repeated position bypasses the cache", all_good);
+	expect(repeated.setPosition("4k3/8/8/8/8/8/4P3/R3K3 w - - 0 80") &&
+	           search(repeated, 4, lines) && shared.stats().probes == stats.probes + 1,
+	       "fresh position probes the cache", all_good);
+	expect(repeated.setPosition("4k3/8/8/8/8/8/4P3/R3K3 w - - 97 80") &&
+	           search(repeated, 4, lines) && shared.stats().probes == stats.probes + 1,
+	       "fifty-move rule in reach bypasses the cache", all_good);
+	shared.setCapacity(0);
+
+	reportSuite(all_good, "result cache",
+	            "result cache limits, replacement, eviction, seeding and history");
+}
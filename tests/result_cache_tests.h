@@ -0,0 +1,3 @@
+#pragma once
+
+void run_result_cache_tests();
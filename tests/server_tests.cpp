@@ -0,0 +1,130 @@
+#include "server_tests.h"
+#include "test_util.h"
+#include "../src/framing.h"
+#include "../src/server.h"
+#include <chrono>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace {
+
+// A client of serveStream over a pair of pipes, sending one request at a time
+class TestClient {
+  public:
+	explicit TestClient(const ServerOptions &opts) {
+		ok = ::pipe(toServer) == 0 && ::pipe(fromServer) == 0;
+		if (ok)
+			server = std::thread([this, opts] {
+				serveStream(opts, toServer[0], fromServer[1]);
+				::close(fromServer[1]);
+			});
+	}
+
+	~TestClient() {
+		if (!ok)
+			return;
+		::close(toServer[1]);
+		server.join();
+		::close(toServer[0]);
+		::close(fromServer[0]);
+	}
+
+	// Send req and return its response, skipping info events. An object without "event" if
+	// the server closed its output.
+	json request(json req) {
+		req["info"] = false;
+		const std::string line = req.dump() + "\n";
+		if (!ok || !writeAll(toServer[1], line))
+			return json::object();
+		std::string reply;
+		char c;
+		while (::read(fromServer[0], &c, 1) == 1) {
+			if (c != '\n') {
+				reply += c;
+				continue;
+			}
+			json out = json::parse(reply, nullptr, false);
+			reply.clear();
+			if (out.is_object() && out.value("event", "") != "info")
+				return out;
+		}
+		return json::object();
+	}
+
+	bool ok = false;
+
+  private:
+	int toServer[2] = {-1, -1};
+	int fromServer[2] = {-1, -1};
+	std::thread server;
+};
+
+bool isUnknownGame(const json &out, const std::string &id) {
+	return out.value("event", "") == "error" && out.value("game", "") == id;
+}
+
+} // namespace
+
+void run_server_tests() {
+	std::cout << "Running server tests..." << std::endl;
+	bool all_good = true;
+
+	ServerOptions opts;
+	opts.threads = 1;
+	opts.config.hashMb = 1;
+	opts.config.evalCacheMb = 1;
+	opts.memoryLimitMb = 3; // room for one session of about 2 MB, not two
+
+	{
+		TestClient client(opts);
+		expect(client.ok, "server pipes", all_good);
+		expect(client.request({{"cmd", "new-game"}, {"game", "g1"}})["event"] == "state",
+		       "new-game g1", all_good);
+		expect(client.request({{"cmd", "new-game"}, {"game", "g2"}})["event"] == "state",
+		       "new-game g2", all_good);
+
+		// The next game request evicts g1, the least recently used session
+		json out = client.request({{"cmd", "state"}, {"game", "g1"}, {"id", 7}});
+		expect(isUnknownGame(out, "g1") && out.value("id", 0) == 7,
+		       "evicted game answered with an error, got " + out.dump(), all_good);
+		out = client.request({{"cmd", "server-stats"}});
+		expect(out.value("sessions", 0) == 1 && out.value("evicted", 0) == 1,
+		       "server-stats after eviction, got " + out.dump(), all_good);
+		out = client.request({{"cmd", "move"}, {"game", "g1"}, {"move", "e2e4"}});
+		expect(isUnknownGame(out, "g1"), "move in evicted game, got " + out.dump(), all_good);
+
+		// An evicted game can be started again, and closing drops it for good
+		expect(client.request({{"cmd", "new-game"}, {"game", "g1"}})["event"] == "state",
+		       "restarting an evicted game", all_good);
+		expect(client.request({{"cmd", "close"}, {"game", "g1"}})["event"] == "closed",
+		       "close g1", all_good);
+		expect(isUnknownGame(client.request({{"cmd", "state"}, {"game", "g1"}}), "g1"),
+		       "state of a closed game", all_good);
+		// The worker drops a closed session just after answering its last request
+		for (int tries = 0; tries < 100; ++tries) {
+			out = client.request({{"cmd", "server-stats"}});
+			if (out.value("sessions", -1) == 0)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		expect(out.value("sessions", -1) == 0, "sessions after close, got " + out.dump(),
+		       all_good);
+	}
+
+	opts.memoryLimitMb = 1024;
+	opts.idleSeconds = 0;
+	{
+		TestClient client(opts);
+		client.request({{"cmd", "new-game"}, {"game", "idle"}});
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		expect(isUnknownGame(client.request({{"cmd", "state"}, {"game", "idle"}}), "idle"),
+		       "game evicted after idling", all_good);
+	}
+
+	reportSuite(all_good, "server", "server eviction, close and server-stats");
+}
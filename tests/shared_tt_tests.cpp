@@ -0,0 +1,132 @@
+#include "shared_tt_tests.h"
+#include "test_util.h"
+#include "../src/shared_memory.h"
+#include "../src/tt.h"
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// Segment names unique to this process, removed again by the test
+std::string segmentName(const char *what) {
+	return "/chess-tt-test-" + std::string(what) + "-" + std::to_string(getpid());
+}
+
+} // namespace
+
+void run_shared_tt_tests() {
+	std::cout << "Running shared hash tests..." << std::endl;
+	bool all_good = true;
+	const std::string name = segmentName("shared");
+	const u64 key = 0x9E3779B97F4A7C15ULL;
+	std::string error;
+	TTEntry entry;
+
+	{
+		// Two tables on one segment, as two processes would attach it
+		TranspositionTable a(1), b(1);
+		expect(a.attachShared(name, 1, &error) && a.isShared(), "first attach: " + error,
+		       all_good);
+		expect(b.attachShared(name, 4, &error) && b.isShared(), "second attach: " + error,
+		       all_good);
+		expect(a.size() == b.size(), "second attach keeps the creator's size", all_good);
+
+		a.newSearch();
+		b.newSearch();
+		a.store(key, 37, 10, BOUND_LOWER, 0x123);
+		expect(b.probe(key, entry) && entry.depth == 10 && entry.score == 37 &&
+		           entry.bound == BOUND_LOWER && entry.move == 0x123,
+		       "entry stored by one attacher probed by the other", all_good);
+
+		// Searches in either process start and run while the other's entries stay deep
+		b.newSearch();
+		a.newSearch();
+		b.store(key, -5, 2, BOUND_UPPER, 0);
+		expect(a.probe(key, entry) && entry.depth == 10 && entry.score == 37,
+		       "shallow store keeps another attacher's deep entry", all_good);
+		for (u64 k = 1; k <= 500; ++k)
+			a.store(k, 0, 1, BOUND_EXACT, 0);
+		expect(b.hashfull() >= 500, "hashfull counts other attachers' entries", all_good);
+		b.store(key, 12, 3, BOUND_EXACT, 0);
+		expect(a.probe(key, entry) && entry.depth == 3 && entry.move == 0x123,
+		       "exact result replaces and keeps the move", all_good);
+
+		// A new game in any process ages the whole table
+		a.store(key, 37, 10, BOUND_LOWER, 0x123);
+		b.clear();
+		b.store(key, -5, 2, BOUND_UPPER, 0);
+		a.newSearch();
+		expect(a.probe(key, entry) && entry.depth == 2, "clear ages the shared entries",
+		       all_good);
+
+		TranspositionTable::SharedStats stats;
+		a.recordProbes(10, 4);
+		b.recordProbes(6, 2);
+		expect(b.sharedStats(stats) && stats.probes == 16 && stats.hits == 6 &&
+		           stats.attached == 2,
+		       "shared totals", all_good);
+		a.resize(1);
+		expect(!a.isShared() && b.sharedStats(stats) && stats.attached == 1,
+		       "resize detaches", all_good);
+
+		// A process that dies while attached is not counted
+		const pid_t child = fork();
+		if (child == 0) {
+			TranspositionTable crashed(1);
+			_exit(crashed.attachShared(name, 1) ? 0 : 1);
+		}
+		int status = 0;
+		expect(child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status) &&
+		           WEXITSTATUS(status) == 0,
+		       "attach in a child process", all_good);
+		expect(b.sharedStats(stats) && stats.attached == 1, "dead process not counted",
+		       all_good);
+	}
+	shm_unlink(name.c_str());
+
+	// A segment from an incompatible build is left alone and the table stays private
+	const std::string badName = segmentName("layout");
+	{
+		SharedMemory segment;
+		bool created = false;
+		expect(segment.open(badName, 4096, created, &error) && created,
+		       "create foreign segment: " + error, all_good);
+		if (segment.isOpen()) {
+			uint32_t *words = static_cast<uint32_t *>(segment.data());
+			words[1] = 0xFFFF; // version
+			words[0] = 1;      // ready
+		}
+		TranspositionTable t(1);
+		error.clear();
+		expect(!t.attachShared(badName, 1, &error) && !t.isShared() &&
+		           error.find("incompatible") != std::string::npos,
+		       "version mismatch falls back to a private table", all_good);
+		t.store(key, 7, 4, BOUND_EXACT, 0);
+		expect(t.probe(key, entry) && entry.score == 7, "private fallback table works",
+		       all_good);
+	}
+	shm_unlink(badName.c_str());
+
+	// A segment whose creator died before initializing it is taken over by the next attach
+	const std::string abandonedName = segmentName("abandoned");
+	{
+		SharedMemory segment;
+		bool created = false;
+		expect(segment.open(abandonedName, 1 << 16, created, &error) && created,
+		       "create abandoned segment: " + error, all_good);
+		TranspositionTable t(1);
+		error.clear();
+		expect(t.attachShared(abandonedName, 1, &error) && t.isShared(),
+		       "abandoned segment initialized: " + error, all_good);
+		t.store(key, 7, 4, BOUND_EXACT, 0);
+		expect(t.probe(key, entry) && entry.score == 7, "initialized segment works", all_good);
+	}
+	shm_unlink(abandonedName.c_str());
+
+	reportSuite(all_good, "shared hash",
+	            "shared hash attach, probes, replacement, crash recovery and layout check");
+}
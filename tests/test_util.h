@@ -0,0 +1,23 @@
+#pragma once
+#include <iostream>
+#include <string>
+
+// Checks shared by the test suites. A suite starts with all_good set, runs its checks and
+// reports once at the end with reportSuite.
+
+// Print what failed and clear all_good unless condition holds; returns condition
+inline bool expect(bool condition, const std::string &what, bool &all_good) {
+	if (!condition) {
+		std::cerr << "FAILED: " << what << '\n';
+		all_good = false;
+	}
+	return condition;
+}
+
+// The closing line of a suite: "Some <suite> tests FAILED!" or "OK: <summary>"
+inline void reportSuite(bool all_good, const std::string &suite, const std::string &summary) {
+	if (!all_good)
+		std::cerr << "Some " << suite << " tests FAILED!" << std::endl;
+	else
+		std::cout << "OK: " << summary << std::endl;
+}
@@ -1,12 +1,15 @@
 # web/app.py
-from fastapi import FastAPI, HTTPException
+from fastapi import FastAPI, HTTPException, Request, Response
 from fastapi.staticfiles import StaticFiles
 from fastapi.responses import HTMLResponse
 from pydantic import BaseModel
+from collections import OrderedDict
 import os
-import json
 import subprocess
 import threading
+import uuid
+
+from web import libchess
 
 
 app = FastAPI()
@@ -38,57 +41,79 @@ def tests_page():
     return read_html("tests.html")
 
 
-# --------- ENGINE PROCESS MANAGEMENT ---------
+# --------- ENGINE SESSIONS ---------
+# Games run in-process through libchess (src/chess_api.h). Each browser gets a game id cookie
+# naming its session; searches release the GIL, so different games think concurrently.
+
+ENGINE_PATH = "/usr/local/bin/chess"  # where Docker copies it; used for --run-tests
+ENGINE_LIB = os.environ.get("CHESS_LIB", "/usr/local/lib/libchess.so")
+GAME_COOKIE = "game_id"
+MAX_GAMES = 256  # least recently used idle games are dropped beyond this
+RESULT_CACHE_MB = 64  # searches shared between games, so common openings are answered at once
+
+# EngineConfig defaults of the JSON protocol
+MAX_DEPTH = 10
+THINK_TIME_MS = 2000
+ANALYSIS_TIME_MS = 1000
+
+engine_lib = None
+
+
+class Game:
+    def __init__(self):
+        self.session = libchess.Session(_lib())
+        self.lock = threading.Lock()  # one request at a time per game
+        self.info: dict | None = None  # latest progress of a running search
+
 
-engine_proc: subprocess.Popen | None = None
-engine_lock = threading.Lock()
+games: OrderedDict[str, Game] = OrderedDict()
+games_lock = threading.Lock()
 
-ENGINE_PATH = "/usr/local/bin/chess"  # where Docker copies it
 
+def _lib():
+    global engine_lib
+    if engine_lib is None:
+        engine_lib = libchess.load(ENGINE_LIB)
+        engine_lib.chess_set_result_cache(RESULT_CACHE_MB)
+    return engine_lib
 
-def _kill_engine():
-    global engine_proc
-    if engine_proc and engine_proc.poll() is None:
-        try:
-            engine_proc.terminate()
-        except Exception:
-            pass
-    engine_proc = None
 
-def _start_engine_protocol():
-    global engine_proc
-    _kill_engine()
+def _get_game(game_id: str, create: bool = False) -> Game | None:
+    with games_lock:
+        game = games.get(game_id)
+        if game is None and create:
+            game = games[game_id] = Game()
+            # Drop the least recently used idle games beyond the cap
+            for gid in list(games):
+                if len(games) <= MAX_GAMES:
+                    break
+                if not games[gid].lock.locked():
+                    del games[gid]
+        if game is not None:
+            games.move_to_end(game_id)
+        return game
 
-    engine_proc = subprocess.Popen(
-        [ENGINE_PATH, "--protocol"],
-        stdin=subprocess.PIPE,
-        stdout=subprocess.PIPE,
-        stderr=subprocess.STDOUT,
-        text=True,
-        bufsize=1,
-    )
-    if not engine_proc.stdin or not engine_proc.stdout:
-        raise RuntimeError("Failed to open engine stdio")
 
-def _rpc(cmd: dict) -> dict:
-    if not engine_proc or engine_proc.poll() is not None:
-        raise RuntimeError("Engine not running")
+def _state(game: Game) -> dict:
+    fen = game.session.fen()
+    return {"event": "state", "fen": fen, "side_to_move": fen.split()[1],
+            "status": game.session.status()}
 
-    assert engine_proc.stdin and engine_proc.stdout
 
-    engine_proc.stdin.write(json.dumps(cmd) + "\n")
-    engine_proc.stdin.flush()
+def _game(request: Request) -> Game:
+    game = _get_game(request.cookies.get(GAME_COOKIE) or "")
+    if game is None:
+        raise HTTPException(status_code=400, detail="No active game. Start a new game first.")
+    return game
 
-    line = engine_proc.stdout.readline()
-    if not line:
-        raise RuntimeError("Engine terminated")
-    if line == "":
-        rc = engine_proc.poll()
-        raise RuntimeError(f"Engine terminated or produced no output (returncode={rc}).")
+
+def _search(game: Game, **limits) -> dict | None:
+    def progress(info: dict):
+        game.info = {"event": "info", **info}
     try:
-        return json.loads(line)
-    except json.JSONDecodeError:
-        raise RuntimeError(f"Engine returned non-JSON: {line!r}")
+        return game.session.search(depth=MAX_DEPTH, progress=progress, **limits)
+    finally:
+        game.info = None
 
 
 # --------- API MODELS ---------
@@ -96,29 +121,76 @@ def _rpc(cmd: dict) -> dict:
 class MoveRequest(BaseModel):
     move: str
 
+class AnalyzeRequest(BaseModel):
+    multipv: int = 3
+
 # --------- API ENDPOINTS ---------
 
 @app.post("/api/new-game")
-def api_new_game(human_color: str = "w"):
-    with engine_lock:
-        try:
-            _start_engine_protocol()
-            res = _rpc({"cmd": "new-game", "human_color": human_color})
-        except Exception as e:
-            raise HTTPException(status_code=500, detail=str(e))
+def api_new_game(request: Request, response: Response, human_color: str = "w"):
+    game_id = request.cookies.get(GAME_COOKIE) or uuid.uuid4().hex
+    try:
+        game = _get_game(game_id, create=True)
+    except Exception as e:
+        raise HTTPException(status_code=500, detail=str(e))
+    with game.lock:
+        game.session.new_game()
+        res = _state(game)
+    response.set_cookie(GAME_COOKIE, game_id, httponly=True, samesite="strict")
     return {"ok": True, "engine": res}
 
 @app.post("/api/move")
-def api_move(req: MoveRequest):
-    with engine_lock:
-        if not engine_proc or engine_proc.poll() is not None:
-            raise HTTPException(status_code=400, detail="No active game. Start a new game first.")
-        try:
-            res = _rpc({"cmd": "move", "move": req.move})
-        except Exception as e:
-            raise HTTPException(status_code=500, detail=str(e))
+def api_move(req: MoveRequest, request: Request):
+    game = _game(request)
+    with game.lock:
+        if not game.session.make_move(req.move):
+            return {"ok": True, "engine": {"event": "error",
+                                           "message": "Move not found in legal moves"}}
+        # If the human move ended the game, report the state at once
+        if game.session.status() != "ongoing":
+            return {"ok": True, "engine": _state(game)}
+
+        result = _search(game, time_ms=THINK_TIME_MS)
+        if result is None or not game.session.make_move(result["lines"][0]["pv"][0]):
+            return {"ok": True, "engine": {"event": "error", "message": "engine failed to move"}}
+        res = _state(game)
+        res["engine_move"] = result["lines"][0]["pv"][0]
+        res["stats"] = {"nodes": result["nodes"], "seldepth": result["seldepth"],
+                        "time_ms": result["time_ms"]}
     return {"ok": True, "engine": res}
 
+@app.post("/api/analyze")
+def api_analyze(req: AnalyzeRequest, request: Request):
+    game = _game(request)
+    with game.lock:
+        result = _search(game, time_ms=ANALYSIS_TIME_MS, multipv=req.multipv)
+        if result is None:
+            return {"ok": True, "engine": {"event": "error", "message": "nothing to analyze"}}
+        res = _state(game)
+        res["event"] = "analysis"
+        res["lines"] = [{"rank": i + 1, **line} for i, line in enumerate(result["lines"])]
+        res["stats"] = {"nodes": result["nodes"], "seldepth": result["seldepth"],
+                        "time_ms": result["time_ms"]}
+    return {"ok": True, "engine": res}
+
+@app.get("/api/legal-moves")
+def api_legal_moves(request: Request):
+    game = _game(request)
+    with game.lock:
+        res = _state(game)
+        res["event"] = "legal-moves"
+        res["moves"] = game.session.legal_moves()
+    return {"ok": True, "engine": res}
+
+@app.get("/api/info")
+def api_info(request: Request):
+    """
+    Latest progress of the engine search running for this game, if any
+    """
+    game = _get_game(request.cookies.get(GAME_COOKIE) or "")
+    info = game.info if game else None
+    return {"searching": info is not None, "info": info}
+
 @app.post("/api/run-tests")
 def run_tests():
     """
@@ -145,34 +217,13 @@ def run_tests():
 @app.get("/perft")
 def perft(depth: int = 3):
     """
-    Debug endpoint: chess --perft <depth>
+    Debug endpoint: perft of the start position, in-process
     """
     try:
-        result = subprocess.run(
-            [ENGINE_PATH, "--perft", str(depth)],
-            capture_output=True,
-            text=True,
-            check=True,
-        )
-    except subprocess.CalledProcessError as e:
-        raise HTTPException(
-            status_code=500,
-            detail=f"Engine error: {e.stderr or e.stdout or 'no output'}",
-        )
+        session = libchess.Session(_lib())
+        nodes = session.perft(depth)
+        session.close()
     except Exception as e:
         raise HTTPException(status_code=500, detail=f"Failed to run engine: {e}")
 
-    out = result.stdout.strip()
-    if not out:
-        raise HTTPException(status_code=500, detail="Empty engine output")
-
-    last_line = out.splitlines()[-1]
-    try:
-        nodes = int(last_line)
-    except ValueError:
-        raise HTTPException(
-            status_code=500,
-            detail=f"Unexpected engine output: {out!r}",
-        )
-
     return {"depth": depth, "nodes": nodes}
@@ -0,0 +1,141 @@
+# web/libchess.py
+"""
+ctypes binding for libchess, the engine's shared library (see src/chess_api.h).
+"""
+import ctypes
+import os
+from typing import Callable, Optional
+
+API_VERSION = 1
+MAX_LINES = 8
+PV_SIZE = 512
+MOVES_SIZE = 2048
+
+# Indexed by chess_game_status; the same names the JSON protocol uses
+STATUS = ["ongoing", "checkmate", "stalemate", "repetition", "fifty-moves",
+          "insufficient-material"]
+
+
+class SearchLimits(ctypes.Structure):
+    _fields_ = [("depth", ctypes.c_int), ("time_ms", ctypes.c_int),
+                ("nodes", ctypes.c_uint64), ("multipv", ctypes.c_int)]
+
+
+class SearchInfo(ctypes.Structure):
+    _fields_ = [("depth", ctypes.c_int), ("seldepth", ctypes.c_int), ("score", ctypes.c_int),
+                ("nodes", ctypes.c_uint64), ("nps", ctypes.c_uint64), ("time_ms", ctypes.c_int),
+                ("hashfull", ctypes.c_int), ("pv", ctypes.c_char_p)]
+
+
+class SearchLine(ctypes.Structure):
+    _fields_ = [("depth", ctypes.c_int), ("score", ctypes.c_int),
+                ("pv", ctypes.c_char * PV_SIZE)]
+
+
+class SearchResult(ctypes.Structure):
+    _fields_ = [("line_count", ctypes.c_int), ("lines", SearchLine * MAX_LINES),
+                ("nodes", ctypes.c_uint64), ("seldepth", ctypes.c_int),
+                ("time_ms", ctypes.c_int)]
+
+
+PROGRESS = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.POINTER(SearchInfo), ctypes.c_void_p)
+
+
+def load(path: str) -> ctypes.CDLL:
+    lib = ctypes.CDLL(path)
+    session = ctypes.c_void_p
+    signatures = {
+        "chess_api_version": (ctypes.c_int, []),
+        "chess_session_new": (session, [ctypes.c_int]),
+        "chess_session_free": (None, [session]),
+        "chess_new_game": (None, [session]),
+        "chess_set_fen": (ctypes.c_int, [session, ctypes.c_char_p]),
+        "chess_get_fen": (ctypes.c_int, [session, ctypes.c_char_p, ctypes.c_size_t]),
+        "chess_make_move": (ctypes.c_int, [session, ctypes.c_char_p]),
+        "chess_legal_moves": (ctypes.c_int, [session, ctypes.c_char_p, ctypes.c_size_t]),
+        "chess_game_status": (ctypes.c_int, [session]),
+        "chess_perft": (ctypes.c_uint64, [session, ctypes.c_int]),
+        "chess_search": (ctypes.c_int, [session, ctypes.POINTER(SearchLimits), PROGRESS,
+                                        ctypes.c_void_p, ctypes.POINTER(SearchResult)]),
+        "chess_session_stop": (None, [session]),
+        "chess_set_result_cache": (None, [ctypes.c_size_t]),
+    }
+    for name, (restype, argtypes) in signatures.items():
+        fn = getattr(lib, name)
+        fn.restype = restype
+        fn.argtypes = argtypes
+    version = lib.chess_api_version()
+    if version != API_VERSION:
+        raise RuntimeError(f"{path} has API version {version}, expected {API_VERSION}")
+    return lib
+
+
+class Session:
+    """One game: a position with its own hash tables. Use it from one thread at a time."""
+
+    def __init__(self, lib: ctypes.CDLL, hash_mb: int = 0):
+        self.lib = lib
+        self.handle = lib.chess_session_new(hash_mb)
+        if not self.handle:
+            raise MemoryError("chess_session_new failed")
+
+    def close(self):
+        if self.handle:
+            self.lib.chess_session_free(self.handle)
+            self.handle = None
+
+    def __del__(self):
+        self.close()
+
+    def new_game(self):
+        self.lib.chess_new_game(self.handle)
+
+    def set_fen(self, fen: str) -> bool:
+        return self.lib.chess_set_fen(self.handle, fen.encode()) == 0
+
+    def fen(self) -> str:
+        buf = ctypes.create_string_buffer(128)
+        self.lib.chess_get_fen(self.handle, buf, len(buf))
+        return buf.value.decode()
+
+    def make_move(self, uci: str) -> bool:
+        return self.lib.chess_make_move(self.handle, uci.encode()) == 0
+
+    def legal_moves(self) -> list[str]:
+        buf = ctypes.create_string_buffer(MOVES_SIZE)
+        self.lib.chess_legal_moves(self.handle, buf, len(buf))
+        return buf.value.decode().split()
+
+    def status(self) -> str:
+        return STATUS[self.lib.chess_game_status(self.handle)]
+
+    def perft(self, depth: int) -> int:
+        return self.lib.chess_perft(self.handle, depth)
+
+    def search(self, depth: int = 0, time_ms: int = 0, nodes: int = 0, multipv: int = 1,
+               progress: Optional[Callable[[dict], Optional[bool]]] = None) -> Optional[dict]:
+        """
+        Rank the best moves without playing any. progress gets info dicts while the engine
+        thinks and stops the search by returning True. None when there is no legal move.
+        """
+        def on_progress(info, _user):
+            i = info.contents
+            stop = progress({"depth": i.depth, "seldepth": i.seldepth, "score": i.score,
+                             "nodes": i.nodes, "nps": i.nps, "time_ms": i.time_ms,
+                             "hashfull": i.hashfull, "pv": i.pv.decode().split()})
+            return 1 if stop else 0
+
+        callback = PROGRESS(on_progress) if progress else PROGRESS()
+        limits = SearchLimits(depth, time_ms, nodes, multipv)
+        result = SearchResult()
+        if self.lib.chess_search(self.handle, ctypes.byref(limits), callback, None,
+                                 ctypes.byref(result)) != 0:
+            return None
+        lines = [{"depth": line.depth, "score": line.score, "pv": line.pv.decode().split()}
+                 for line in result.lines[:result.line_count]]
+        return {"lines": lines, "nodes": result.nodes, "seldepth": result.seldepth,
+                "time_ms": result.time_ms}
+
+    def stop(self):
+        """Safe from any thread: end a running search with its best lines so far."""
+        self.lib.chess_session_stop(self.handle)
@@ -2,6 +2,7 @@
 
 let selectedFrom = null;
 let lastFen = null;
+let legalMoves = null; // UCI moves of lastFen, null until fetched
 
 const PIECE_GLYPHS = {
   P: "♙", N: "♘", B: "♗", R: "♖", Q: "♕", K: "♔",
@@ -47,13 +48,19 @@ function fenToBoardArray(fen) {
 }
 
 function clearSelectionStyles() {
-  document.querySelectorAll(".square.selected").forEach(el => el.classList.remove("selected"));
+  document.querySelectorAll(".square.selected, .square.target")
+    .forEach(el => el.classList.remove("selected", "target"));
 }
 
 function setSelectedSquare(square) {
   clearSelectionStyles();
   const el = document.querySelector(`.square[data-square="${square}"]`);
   if (el) el.classList.add("selected");
+  for (const m of legalMoves || []) {
+    if (!m.startsWith(square)) continue;
+    const target = document.querySelector(`.square[data-square="${m.slice(2, 4)}"]`);
+    if (target) target.classList.add("target");
+  }
 }
 
 function getPieceAtSquareFromFen(fen, square) {
@@ -152,6 +159,80 @@ async function apiMove(move) {
   return data.engine;
 }
 
+async function apiLegalMoves() {
+  const res = await fetch("/api/legal-moves");
+  const data = await res.json();
+  if (!data.ok) throw new Error(data.detail || "legal-moves failed");
+  return data.engine;
+}
+
+// Fetch the legal moves once per position so clicks and typed moves are checked locally
+async function refreshLegalMoves() {
+  legalMoves = null;
+  try {
+    const eng = await apiLegalMoves();
+    if (eng.fen === lastFen) legalMoves = eng.moves || [];
+  } catch (e) {
+    // Without the list every move is left to the engine to judge
+  }
+}
+
+async function apiAnalyze(multipv) {
+  const res = await fetch("/api/analyze", {
+    method: "POST",
+    headers: { "Content-Type": "application/json" },
+    body: JSON.stringify({ multipv }),
+  });
+  const data = await res.json();
+  if (!data.ok) throw new Error(data.detail || "analyze failed");
+  return data.engine;
+}
+
+async function apiInfo() {
+  const res = await fetch("/api/info");
+  return res.json();
+}
+
+// Show the engine's search progress in the status line until stop() is called
+function watchSearch() {
+  let stopped = false;
+  const timer = setInterval(async () => {
+    try {
+      const data = await apiInfo();
+      if (stopped || !data.searching) return;
+      const i = data.info;
+      $("status").textContent =
+        `Thinking: depth ${i.depth}/${i.seldepth} (${(i.score / 100).toFixed(2)}) ` +
+        `${i.nodes} nodes ${i.nps} nps: ${i.pv.join(" ")}`;
+    } catch (e) {
+      // Progress is best effort; the move request reports real errors
+    }
+  }, 250);
+  return () => {
+    stopped = true;
+    clearInterval(timer);
+  };
+}
+
+function formatAnalysis(lines) {
+  return lines
+    .map(l => `${l.rank}. (${(l.score / 100).toFixed(2)}) depth ${l.depth}: ${l.pv.join(" ")}`)
+    .join("\n");
+}
+
+async function analyze() {
+  if (!lastFen) return;
+  const multipv = Number($("multipvSelect").value) || 1;
+
+  try {
+    const eng = await apiAnalyze(multipv);
+    if (eng.event === "error") throw new Error(eng.message || "Engine error");
+    updateOutput(formatAnalysis(eng.lines || []));
+  } catch (e) {
+    $("status").textContent = "Error: " + e.message;
+  }
+}
+
 async function newGame() {
   $("status").textContent = "Starting...";
   updateOutput("");
@@ -163,6 +244,7 @@ async function newGame() {
     lastFen = eng.fen;
     renderBoardFromFen(lastFen);
     updateStatusFromEngine(eng);
+    refreshLegalMoves();
 
     // Debug payload
     updateOutput(JSON.stringify(eng, null, 2));
@@ -177,9 +259,14 @@ async function sendMove() {
   const moveInput = $("moveInput");
   const move = moveInput.value.trim();
   if (!move) return;
+  if (legalMoves && !legalMoves.includes(move.toLowerCase())) {
+    $("status").textContent = "Illegal move: " + move;
+    return;
+  }
 
+  const stopWatching = watchSearch();
   try {
-    const eng = await apiMove(move);
+    const eng = await apiMove(move).finally(stopWatching);
 
     if (eng.event === "error") {
       $("status").textContent = "Illegal move: " + (eng.message || "");
@@ -189,6 +276,7 @@ async function sendMove() {
     lastFen = eng.fen;
     renderBoardFromFen(lastFen);
     updateStatusFromEngine(eng);
+    refreshLegalMoves();
 
     // Debug payload
     updateOutput(JSON.stringify(eng, null, 2));
@@ -205,6 +293,7 @@ document.addEventListener("DOMContentLoaded", () => {
   $("backBtn").addEventListener("click", () => (window.location.href = "/"));
   $("newGameBtn").addEventListener("click", newGame);
   $("submitBtn").addEventListener("click", sendMove);
+  $("analyzeBtn").addEventListener("click", analyze);
 
   $("moveInput").addEventListener("keydown", (e) => {
     if (e.key === "Enter") sendMove();
@@ -220,7 +309,14 @@ document.addEventListener("DOMContentLoaded", () => {
     // If no game loaded yet, ignore
     if (!lastFen) return;
 
+    // A square with no legal moves cannot start one; another starting square reselects
+    const movesFrom = from => (legalMoves || []).some(m => m.startsWith(from));
+    if (selectedFrom && legalMoves && movesFrom(sq) &&
+        !legalMoves.some(m => m.startsWith(selectedFrom + sq))) {
+      selectedFrom = null;
+    }
     if (!selectedFrom) {
+      if (legalMoves && !movesFrom(sq)) return;
       selectedFrom = sq;
       setSelectedSquare(sq);
       $("moveInput").value = sq; // optional